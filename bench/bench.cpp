@@ -0,0 +1,342 @@
+#pragma GCC optimize(3)
+#pragma GCC optimize("inline")
+
+#include <iostream>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "../common/dataset_driver.h"
+#include "../solve/scheduler.h"
+#include "workload.h"
+
+// 一个基准规模
+class BenchCase {
+public:
+    int flows;
+    int ports;
+
+public:
+    BenchCase(int flows, int ports) {
+        this->flows = flows;
+        this->ports = ports;
+    }
+};
+
+// 一个阶段的开销：墙上时间与该阶段内的峰值常驻内存
+class PhaseStats {
+public:
+    std::string name;
+    double wall_time = 0;
+    long peak_memory_kb = 0;
+};
+
+// 运行一个阶段，单独统计其时间与峰值内存
+PhaseStats run_phase(const std::string &name, const std::function<void()> &phase) {
+    PhaseStats stats;
+    stats.name = name;
+    reset_peak_memory();
+    auto start = std::chrono::steady_clock::now();
+    phase();
+    stats.wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stats.peak_memory_kb = peak_memory_kb();
+    return stats;
+}
+
+// 分支点个数，以及每个分支点向后试调度的流数
+const int BRANCH_POINTS = 100;
+const int BRANCH_FLOWS = 1000;
+
+// 在flows上均匀取BRANCH_POINTS个分支点，每处打快照，试调度其后的BRANCH_FLOWS个流并发出剩余的流，再回滚到快照继续调度
+// 回滚完全恢复了状态时，最终的决策与不分支的调度结果expected相同
+bool branch_schedule(const std::vector<Flow> &flows, const std::vector<Port> &ports,
+                     const std::vector<Decision> &expected) {
+    long long total_bandwidth = 0;
+    for (auto &flow: flows) {
+        total_bandwidth += flow.bandwidth;
+    }
+    ScheduleState state(ports, (double) total_bandwidth / (double) flows.size(), SolveConfig());
+    MemoryResultSink decisions;
+    size_t step = std::max<size_t>(1, flows.size() / BRANCH_POINTS);
+    for (size_t i = 0; i < flows.size(); i++) {
+        if (i % step == 0) {
+            ScheduleState::Snapshot snapshot = state.mark();
+            MemoryResultSink branch;
+            for (size_t j = i; j < std::min(flows.size(), i + BRANCH_FLOWS); j++) {
+                state.arrive(flows[j], branch);
+            }
+            state.finish(branch);
+            state.rollback(snapshot);
+            state.release();
+        }
+        state.arrive(flows[i], decisions);
+    }
+    state.finish(decisions);
+    if (decisions.decisions.size() != expected.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < expected.size(); i++) {
+        const Decision &a = decisions.decisions[i];
+        const Decision &b = expected[i];
+        if (a.flow_id != b.flow_id || a.port_id != b.port_id || a.send_time != b.send_time) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 按到达时间逐个把flows交给在线调度器，流读完后推进到所有流都处理完，结果存入scheduler_decisions
+// 平均带宽与离线调度相同时，决策集合与schedule的结果相同
+void replay_online(const std::vector<Flow> &flows, const std::vector<Port> &ports, Scheduler &scheduler,
+                   std::vector<Decision> &scheduler_decisions) {
+    for (auto &port: ports) {
+        scheduler.add_port(port.id, port.max_bandwidth);
+    }
+    for (auto &flow: flows) {
+        Scheduler::Admission admission = scheduler.on_arrival(flow, flow.coming_time);
+        if (admission.kind != Scheduler::Admission::DEFERRED) {
+            scheduler_decisions.emplace_back(flow.id, admission.port_id, scheduler.schedule_state().time);
+        }
+    }
+    const Scheduler::Issued &issued = scheduler.advance(INT_MAX);
+    scheduler_decisions.insert(scheduler_decisions.end(), issued.sent.begin(), issued.sent.end());
+    scheduler_decisions.insert(scheduler_decisions.end(), issued.discarded.begin(), issued.discarded.end());
+}
+
+// 两组决策作为集合是否相同
+bool same_decisions(std::vector<Decision> a, std::vector<Decision> b) {
+    auto less = [](const Decision &x, const Decision &y) {
+        return std::make_tuple(x.flow_id, x.port_id, x.send_time) < std::make_tuple(y.flow_id, y.port_id, y.send_time);
+    };
+    std::sort(a.begin(), a.end(), less);
+    std::sort(b.begin(), b.end(), less);
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const Decision &x, const Decision &y) {
+        return x.flow_id == y.flow_id && x.port_id == y.port_id && x.send_time == y.send_time;
+    });
+}
+
+// 在dir下生成一个数据集，依次计时：
+// parse（读入flow.txt、port.txt）、sort（sort_flows）、simulate（schedule）、
+// branch（带BRANCH_POINTS次快照、试调度与回滚的schedule）、online（用在线调度器Scheduler逐个调度）、write（写出result.txt），
+// 以及评测程序的读入result.txt（eval_parse）、阶段一评分（stage1）、阶段二评分（stage2），
+// 和用全部硬件线程并行模拟端口的阶段一、阶段二评分（stage1_parallel、stage2_parallel），其结果须与单线程相同
+std::vector<PhaseStats> run_case(const BenchCase &bench_case, const std::string &dir, unsigned long long seed) {
+    WorkloadSpec spec;
+    spec.flows = bench_case.flows;
+    spec.ports = bench_case.ports;
+    spec.seed = seed;
+    spec.overload = 1.2;
+    generate_workload(spec, dir);
+    std::vector<PhaseStats> phases;
+    std::vector<Flow> flows;
+    std::vector<Port> ports;
+    MemoryResultSink decisions;
+    std::vector<FlowInfo> flow_info;
+    std::vector<PortInfo> port_info;
+    std::vector<Decision> results;
+    phases.push_back(run_phase("parse", [&]() {
+        read_files(dir, flows, ports);
+    }));
+    flow_info = flow_infos(flows);
+    port_info = port_infos(ports);
+    phases.push_back(run_phase("sort", [&]() {
+        sort_flows(flows, SolveConfig().flow_order);
+    }));
+    phases.push_back(run_phase("simulate", [&]() {
+        schedule(flows, ports, decisions);
+    }));
+    phases.push_back(run_phase("branch", [&]() {
+        if (!branch_schedule(flows, ports, decisions.decisions)) {
+            std::cerr << dir << ": schedule changed after rolling back to snapshots" << std::endl;
+        }
+    }));
+    long long total_bandwidth = 0;
+    for (auto &flow: flows) {
+        total_bandwidth += flow.bandwidth;
+    }
+    Scheduler scheduler(SolveConfig(), (double) total_bandwidth / (double) flows.size());
+    std::vector<Decision> scheduler_decisions;
+    phases.push_back(run_phase("online", [&]() {
+        replay_online(flows, ports, scheduler, scheduler_decisions);
+    }));
+    if (!same_decisions(scheduler_decisions, decisions.decisions)) {
+        std::cerr << dir << ": online scheduler differs from schedule" << std::endl;
+    }
+    std::cout << dir << ": on_arrival p50 " << scheduler.arrival_latency.percentile(0.5) << "ns, p99 "
+              << scheduler.arrival_latency.percentile(0.99) << "ns, max " << scheduler.arrival_latency.max() << "ns"
+              << std::endl;
+    phases.push_back(run_phase("write", [&]() {
+        TextResultSink sink;
+        sink.open(dir + "/result.txt");
+        for (auto &decision: decisions.decisions) {
+            sink.put(decision.flow_id, decision.port_id, decision.send_time);
+        }
+        sink.close();
+    }));
+    phases.push_back(run_phase("eval_parse", [&]() {
+        CsvFile file;
+        if (file.open(dir + "/result.txt", false)) {
+            results.reserve(file.row_hint());
+            int row[3];
+            while (file.next(row)) {
+                results.emplace_back(row[0], row[1], row[2]);
+            }
+        }
+    }));
+    Score scores[4];
+    phases.push_back(run_phase("stage1", [&]() {
+        scores[0] = score_stage1(flow_info, port_info, results);
+    }));
+    phases.push_back(run_phase("stage2", [&]() {
+        scores[1] = score_stage2(flow_info, port_info, results);
+    }));
+    phases.push_back(run_phase("stage1_parallel", [&]() {
+        scores[2] = score_stage1(flow_info, port_info, results, default_threads());
+    }));
+    phases.push_back(run_phase("stage2_parallel", [&]() {
+        scores[3] = score_stage2(flow_info, port_info, results, default_threads());
+    }));
+    if (scores[2].makespan != scores[0].makespan || scores[3].makespan != scores[1].makespan ||
+        scores[3].overflow_penalty != scores[1].overflow_penalty) {
+        std::cerr << dir << ": parallel scoring differs from single-threaded scoring" << std::endl;
+    }
+    return phases;
+}
+
+// 端口选择的微基准：P个端口上反复做最佳适配，找到则占用其带宽，否则把一个随机端口恢复到最大带宽
+// 有序集合（lower_bound查询、erase/emplace更新）与端口表上各指令集的扫描内核做同一串操作，
+// 输出每次操作的纳秒数并写入scan_report.csv，选择的端口序列不同时报错；据此确定各内核的port_limit
+void scan_bench(const std::string &work_dir, unsigned long long seed) {
+    const int OPERATIONS = 1000000;
+    std::ofstream report(work_dir + "/scan_report.csv");
+    report << "ports,method,ns_per_op" << std::endl;
+    for (int ports: {8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096}) {
+        std::mt19937_64 rng(seed);
+        std::vector<int> max_bandwidths(ports);
+        for (auto &bandwidth: max_bandwidths) {
+            bandwidth = std::uniform_int_distribution<int>(100, 1000)(rng);
+        }
+        std::vector<int> bandwidths(OPERATIONS);
+        std::vector<int> restores(OPERATIONS);
+        for (int i = 0; i < OPERATIONS; i++) {
+            bandwidths[i] = std::uniform_int_distribution<int>(1, 300)(rng);
+            restores[i] = std::uniform_int_distribution<int>(0, ports - 1)(rng);
+        }
+        // 依次做全部操作，返回所选端口的校验和与每次操作的纳秒数
+        auto run = [&](const std::function<int(int)> &best_fit,
+                       const std::function<void(int, int)> &set_capacity) -> std::pair<long long, double> {
+            std::vector<int> capacities = max_bandwidths;
+            long long checksum = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < OPERATIONS; i++) {
+                int index = best_fit(bandwidths[i]);
+                checksum = checksum * 31 + index;
+                if (index >= 0) {
+                    set_capacity(index, capacities[index] - bandwidths[i]);
+                    capacities[index] -= bandwidths[i];
+                } else {
+                    set_capacity(restores[i], max_bandwidths[restores[i]]);
+                    capacities[restores[i]] = max_bandwidths[restores[i]];
+                }
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            return std::make_pair(checksum, seconds * 1e9 / OPERATIONS);
+        };
+        std::set<std::pair<int, int>> by_capacity;
+        std::vector<int> set_capacities = max_bandwidths;
+        for (int i = 0; i < ports; i++) {
+            by_capacity.emplace(max_bandwidths[i], i);
+        }
+        std::pair<long long, double> tree = run([&](int bandwidth) {
+            auto it = by_capacity.lower_bound({bandwidth, -1});
+            return it == by_capacity.end() ? -1 : it->second;
+        }, [&](int index, int capacity) {
+            by_capacity.erase({set_capacities[index], index});
+            set_capacities[index] = capacity;
+            by_capacity.emplace(capacity, index);
+        });
+        std::cout << ports << " ports: set " << tree.second << "ns";
+        report << ports << ",set," << tree.second << std::endl;
+        for (ScanIsa isa: {ScanIsa::SCALAR, ScanIsa::AVX2, ScanIsa::AVX512}) {
+            const ScanKernels &kernels = scan_kernels(isa);
+            PortTable table(kernels);
+            for (int bandwidth: max_bandwidths) {
+                table.add(bandwidth, bandwidth, 0, (int) table.size());
+            }
+            std::pair<long long, double> scan = run([&](int bandwidth) {
+                return table.best_fit(bandwidth);
+            }, [&](int index, int capacity) {
+                table.capacity[index] = capacity;
+            });
+            if (scan.first != tree.first) {
+                std::cerr << ports << " ports: " << kernels.name << " scan chose different ports" << std::endl;
+            }
+            std::cout << ", " << kernels.name << " " << scan.second << "ns";
+            report << ports << ',' << kernels.name << ',' << scan.second << std::endl;
+        }
+        std::cout << std::endl;
+    }
+}
+
+// 用法：bench [工作目录] [--full] [--max-flows N] [--seed S] [--scan]
+// 默认在/tmp/zte_bench下依次运行从1k流/10端口到10M流/10k端口的规模梯度，--full时运行流数与端口数的全组合
+// 每个规模的各阶段时间与峰值内存输出到标准输出，并写入工作目录下的bench_report.csv
+// --scan时只运行端口选择的微基准scan_bench
+int main(int argc, char *argv[]) {
+    std::string work_dir = "/tmp/zte_bench";
+    bool full = false;
+    bool scan = false;
+    int max_flows = 10000000;
+    unsigned long long seed = 1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--full") {
+            full = true;
+        } else if (arg == "--scan") {
+            scan = true;
+        } else if (arg == "--max-flows" && i + 1 < argc) {
+            max_flows = std::atoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            work_dir = arg;
+        }
+    }
+    std::vector<BenchCase> cases;
+    if (full) {
+        for (int flows: {1000, 10000, 100000, 1000000, 10000000}) {
+            for (int ports: {10, 100, 1000, 10000}) {
+                cases.emplace_back(flows, ports);
+            }
+        }
+    } else {
+        cases = {BenchCase(1000, 10), BenchCase(10000, 10), BenchCase(100000, 100), BenchCase(1000000, 100),
+                 BenchCase(1000000, 1000), BenchCase(10000000, 10000)};
+    }
+    mkdir(work_dir.c_str(), 0755);
+    if (scan) {
+        scan_bench(work_dir, seed);
+        return 0;
+    }
+    std::ofstream report(work_dir + "/bench_report.csv");
+    report << "flows,ports,phase,wall_time,peak_memory_kb" << std::endl;
+    for (auto &bench_case: cases) {
+        if (bench_case.flows > max_flows) {
+            continue;
+        }
+        std::string dir = work_dir + "/" + std::to_string(bench_case.flows) + "_" + std::to_string(bench_case.ports);
+        std::vector<PhaseStats> phases = run_case(bench_case, dir, seed);
+        std::cout << bench_case.flows << " flows, " << bench_case.ports << " ports:";
+        for (auto &phase: phases) {
+            std::cout << " " << phase.name << " " << phase.wall_time << "s/" << phase.peak_memory_kb << "KB";
+            report << bench_case.flows << ',' << bench_case.ports << ',' << phase.name << ',' << phase.wall_time << ','
+                   << phase.peak_memory_kb << std::endl;
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
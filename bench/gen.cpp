@@ -0,0 +1,67 @@
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include "workload.h"
+
+// 解析"min:max"形式的取值范围
+bool parse_range(const std::string &text, int &min, int &max) {
+    size_t colon = text.find(':');
+    if (colon == std::string::npos) {
+        return false;
+    }
+    min = std::atoi(text.substr(0, colon).c_str());
+    max = std::atoi(text.substr(colon + 1).c_str());
+    return min <= max;
+}
+
+// 用法：gen <输出目录> [--flows N] [--ports N] [--seed S] [--bandwidth min:max] [--bandwidth-dist D]
+//          [--occupied min:max] [--occupied-dist D] [--port-bandwidth min:max] [--burstiness P] [--overload R]
+// 分布D为uniform、heavy或exp，各参数的默认值见WorkloadSpec
+int main(int argc, char *argv[]) {
+    WorkloadSpec spec;
+    std::string dir;
+    bool ok = true;
+    for (int i = 1; i < argc && ok; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--flows" && has_value) {
+            spec.flows = std::atoi(argv[++i]);
+        } else if (arg == "--ports" && has_value) {
+            spec.ports = std::atoi(argv[++i]);
+        } else if (arg == "--seed" && has_value) {
+            spec.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--bandwidth" && has_value) {
+            ok = parse_range(argv[++i], spec.bandwidth_min, spec.bandwidth_max);
+        } else if (arg == "--bandwidth-dist" && has_value) {
+            ok = parse_distribution(argv[++i], spec.bandwidth_dist);
+        } else if (arg == "--occupied" && has_value) {
+            ok = parse_range(argv[++i], spec.occupied_min, spec.occupied_max);
+        } else if (arg == "--occupied-dist" && has_value) {
+            ok = parse_distribution(argv[++i], spec.occupied_dist);
+        } else if (arg == "--port-bandwidth" && has_value) {
+            ok = parse_range(argv[++i], spec.port_bandwidth_min, spec.port_bandwidth_max);
+        } else if (arg == "--burstiness" && has_value) {
+            spec.burstiness = std::atof(argv[++i]);
+        } else if (arg == "--overload" && has_value) {
+            spec.overload = std::atof(argv[++i]);
+        } else if (arg[0] != '-' && dir.empty()) {
+            dir = arg;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::cerr << "bad argument: " << arg << std::endl;
+        }
+    }
+    if (!ok || dir.empty() || spec.flows <= 0 || spec.ports <= 0 || spec.overload <= 0) {
+        std::cerr << "usage: gen <dir> [--flows N] [--ports N] [--seed S] [--bandwidth min:max] "
+                     "[--bandwidth-dist uniform|heavy|exp] [--occupied min:max] [--occupied-dist uniform|heavy|exp] "
+                     "[--port-bandwidth min:max] [--burstiness P] [--overload R]" << std::endl;
+        return 1;
+    }
+    if (!generate_workload(spec, dir)) {
+        std::cerr << "can't write " << dir << std::endl;
+        return 1;
+    }
+    return 0;
+}
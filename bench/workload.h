@@ -0,0 +1,147 @@
+#ifndef ZTE_BENCH_WORKLOAD_H
+#define ZTE_BENCH_WORKLOAD_H
+
+// 可复现的合成数据集：按给定的规模与分布生成flow.txt与port.txt，生成器与基准测试共用
+
+#include <algorithm>
+#include <cmath>
+#include <climits>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+// 取值分布
+enum class Distribution {
+    // [min, max]上的均匀分布
+    UNIFORM,
+    // 重尾分布：Pareto(1.5)平移到min，截断到max，大多数取值靠近min，少数很大
+    HEAVY,
+    // 均值为(min+max)/2的指数分布，截断到[min, max]
+    EXPONENTIAL,
+};
+
+class WorkloadSpec {
+public:
+    // 流数量与端口数量
+    int flows = 1000;
+    int ports = 10;
+    // 随机数种子，相同的参数与种子生成完全相同的文件
+    unsigned long long seed = 1;
+    // 流带宽
+    int bandwidth_min = 1;
+    int bandwidth_max = 200;
+    Distribution bandwidth_dist = Distribution::UNIFORM;
+    // 流在端口上的占用时间
+    int occupied_min = 1;
+    int occupied_max = 60;
+    Distribution occupied_dist = Distribution::UNIFORM;
+    // 端口带宽，生成后流带宽会截断到最大的端口带宽，保证每个流都能发出
+    int port_bandwidth_min = 300;
+    int port_bandwidth_max = 1500;
+    // 突发程度：这一比例的流集中在少数突发时刻到达，其余均匀到达
+    double burstiness = 0;
+    // 过载倍数：到达的总负载（带宽×占用时间之和）与端口在到达时间跨度内的总容量之比，大于1时调度区会被填满
+    double overload = 1;
+};
+
+inline const char *distribution_name(Distribution dist) {
+    switch (dist) {
+        case Distribution::UNIFORM:
+            return "uniform";
+        case Distribution::HEAVY:
+            return "heavy";
+        case Distribution::EXPONENTIAL:
+            return "exp";
+    }
+    return "unknown";
+}
+
+inline bool parse_distribution(const std::string &name, Distribution &dist) {
+    for (Distribution d: {Distribution::UNIFORM, Distribution::HEAVY, Distribution::EXPONENTIAL}) {
+        if (name == distribution_name(d)) {
+            dist = d;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline int sample(std::mt19937_64 &rng, Distribution dist, int min, int max) {
+    if (max <= min) {
+        return min;
+    }
+    double value;
+    switch (dist) {
+        case Distribution::HEAVY: {
+            double u = std::uniform_real_distribution<double>(0, 1)(rng);
+            value = min * std::pow(1 - u, -1 / 1.5);
+            break;
+        }
+        case Distribution::EXPONENTIAL:
+            value = std::exponential_distribution<double>(2.0 / (min + max))(rng);
+            break;
+        default:
+            return std::uniform_int_distribution<int>(min, max)(rng);
+    }
+    return std::max(min, std::min(max, (int) std::lround(value)));
+}
+
+// 在目录dir下生成flow.txt与port.txt，目录不存在时创建
+inline bool generate_workload(const WorkloadSpec &spec, const std::string &dir) {
+    mkdir(dir.c_str(), 0755);
+    std::mt19937_64 rng(spec.seed);
+    std::vector<int> port_bandwidths(spec.ports);
+    long long capacity = 0;
+    int port_bandwidth_max = 0;
+    for (auto &bandwidth: port_bandwidths) {
+        bandwidth = std::uniform_int_distribution<int>(spec.port_bandwidth_min, spec.port_bandwidth_max)(rng);
+        capacity += bandwidth;
+        port_bandwidth_max = std::max(port_bandwidth_max, bandwidth);
+    }
+    int bandwidth_max = std::min(spec.bandwidth_max, port_bandwidth_max);
+    int bandwidth_min = std::min(spec.bandwidth_min, bandwidth_max);
+    std::vector<int> bandwidths(spec.flows);
+    std::vector<int> occupied_times(spec.flows);
+    double load = 0;
+    for (int i = 0; i < spec.flows; i++) {
+        bandwidths[i] = sample(rng, spec.bandwidth_dist, bandwidth_min, bandwidth_max);
+        occupied_times[i] = sample(rng, spec.occupied_dist, spec.occupied_min, spec.occupied_max);
+        load += (double) bandwidths[i] * occupied_times[i];
+    }
+    // 到达时间跨度：使总负载恰好为端口总容量的overload倍
+    int horizon = (int) std::max(1.0, std::min((double) INT_MAX / 2, load / (capacity * spec.overload)));
+    // 每个突发时刻平均约100个流
+    int bursts = std::max(1, std::min(horizon, (int) (spec.flows * spec.burstiness / 100)));
+    std::vector<int> burst_times(bursts);
+    for (auto &burst_time: burst_times) {
+        burst_time = std::uniform_int_distribution<int>(0, horizon - 1)(rng);
+    }
+    FILE *flow_file = fopen((dir + "/flow.txt").c_str(), "w");
+    if (flow_file == nullptr) {
+        return false;
+    }
+    setvbuf(flow_file, nullptr, _IOFBF, 1 << 20);
+    fprintf(flow_file, "流id,流带宽,进入设备时间,流发送时间\n");
+    std::uniform_real_distribution<double> coin(0, 1);
+    std::uniform_int_distribution<int> arrival(0, horizon - 1);
+    std::uniform_int_distribution<int> burst(0, bursts - 1);
+    for (int i = 0; i < spec.flows; i++) {
+        int coming_time = coin(rng) < spec.burstiness ? burst_times[burst(rng)] : arrival(rng);
+        fprintf(flow_file, "%d,%d,%d,%d\n", i, bandwidths[i], coming_time, occupied_times[i]);
+    }
+    fclose(flow_file);
+    FILE *port_file = fopen((dir + "/port.txt").c_str(), "w");
+    if (port_file == nullptr) {
+        return false;
+    }
+    fprintf(port_file, "端口id,端口带宽\n");
+    for (int i = 0; i < spec.ports; i++) {
+        fprintf(port_file, "%d,%d\n", i, port_bandwidths[i]);
+    }
+    fclose(port_file);
+    return true;
+}
+
+#endif //ZTE_BENCH_WORKLOAD_H
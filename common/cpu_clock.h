@@ -0,0 +1,31 @@
+#ifndef ZTE_COMMON_CPU_CLOCK_H
+#define ZTE_COMMON_CPU_CLOCK_H
+
+// CPU时间统计：进程时钟用于整次运行的总计，线程时钟用于分别统计并发处理的各个数据集
+
+#include <ctime>
+
+// 进程累计CPU时间（秒），所有线程之和
+inline double process_cpu_seconds() {
+    timespec ts{};
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (double) ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 当前线程累计CPU时间（秒）
+inline double thread_cpu_seconds() {
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (double) ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 当前线程启动的辅助线程（如并行评分的工作线程）用掉的CPU时间（秒），由启动方在join后累加
+// 线程时钟不含这部分，按数据集统计时要加上
+inline thread_local double spawned_cpu_seconds = 0;
+
+// 当前线程及其辅助线程的累计CPU时间（秒）
+inline double task_cpu_seconds() {
+    return thread_cpu_seconds() + spawned_cpu_seconds;
+}
+
+#endif //ZTE_COMMON_CPU_CLOCK_H
@@ -0,0 +1,115 @@
+#ifndef ZTE_COMMON_DATASET_DRIVER_H
+#define ZTE_COMMON_DATASET_DRIVER_H
+
+// 多数据集并发驱动：用固定大小的线程池处理data_root/0, data_root/1, ...，并统计每个数据集的运行开销
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include "cpu_clock.h"
+
+// 单个数据集的运行统计
+class RunStats {
+public:
+    // 墙上时间（秒）
+    double wall_time = 0;
+    // 处理该数据集的线程占用的CPU时间（秒），包括任务自己启动的线程（如并行评分），不含同时在处理的其他数据集
+    double cpu_time = 0;
+    // 峰值常驻内存（KB），单线程运行时为该数据集自身的峰值，多线程运行时为整个进程到此为止的峰值
+    long peak_memory_kb = 0;
+};
+
+// 数据集目录data_root/0, data_root/1, ...，遇到第一个不存在的编号为止
+inline std::vector<std::string> list_datasets(const std::string &data_root) {
+    std::vector<std::string> paths;
+    while (true) {
+        std::string data_path = data_root + "/" + std::to_string(paths.size());
+        struct stat s{};
+        if (stat(data_path.c_str(), &s) != 0 || !(s.st_mode & S_IFDIR)) {
+            break;
+        }
+        paths.push_back(data_path);
+    }
+    return paths;
+}
+
+// 默认线程数：机器的硬件线程数
+inline int default_threads() {
+    return std::max(1, (int) std::thread::hardware_concurrency());
+}
+
+// 进程峰值常驻内存（KB），优先读/proc/self/status中的VmHWM
+inline long peak_memory_kb() {
+    FILE *status = fopen("/proc/self/status", "r");
+    if (status != nullptr) {
+        char line[256];
+        long kb = -1;
+        while (fgets(line, sizeof(line), status) != nullptr) {
+            if (strncmp(line, "VmHWM:", 6) == 0) {
+                kb = strtol(line + 6, nullptr, 10);
+                break;
+            }
+        }
+        fclose(status);
+        if (kb >= 0) {
+            return kb;
+        }
+    }
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// 将进程峰值常驻内存重置为当前值，只在单线程运行时用于分别统计每个数据集
+inline void reset_peak_memory() {
+    FILE *clear_refs = fopen("/proc/self/clear_refs", "w");
+    if (clear_refs != nullptr) {
+        fputs("5", clear_refs);
+        fclose(clear_refs);
+    }
+}
+
+// 用threads个线程并发处理count个数据集，task(i)处理第i个数据集，返回各数据集的运行统计
+// 各线程从共享计数器中领取下一个数据集编号，数据集大小不均时也能保持负载均衡
+template<typename Task>
+std::vector<RunStats> run_datasets(int count, int threads, Task task) {
+    std::vector<RunStats> stats(count);
+    threads = std::max(1, std::min(threads, count));
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+        int i;
+        while ((i = next.fetch_add(1)) < count) {
+            if (threads == 1) {
+                reset_peak_memory();
+            }
+            auto wall_start = std::chrono::steady_clock::now();
+            double cpu_start = task_cpu_seconds();
+            task(i);
+            stats[i].cpu_time = task_cpu_seconds() - cpu_start;
+            stats[i].wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+            stats[i].peak_memory_kb = peak_memory_kb();
+        }
+    };
+    if (threads == 1) {
+        worker();
+    } else {
+        std::vector<std::thread> pool;
+        for (int t = 0; t < threads; t++) {
+            pool.emplace_back(worker);
+        }
+        for (auto &thread: pool) {
+            thread.join();
+        }
+    }
+    return stats;
+}
+
+#endif //ZTE_COMMON_DATASET_DRIVER_H
@@ -0,0 +1,88 @@
+#ifndef ZTE_COMMON_INLINE_RING_H
+#define ZTE_COMMON_INLINE_RING_H
+
+// 定长环形队列：元素直接存放在对象内，不做任何堆分配
+// 用作端口排队区：排队区容量是编译期常量PORT_QUEUE_LIMIT，30个int加上首尾位置正好两条缓存行
+
+#include <cstdint>
+
+template<typename T, int N>
+class InlineRing {
+    static_assert(N > 0 && N <= UINT16_MAX, "InlineRing capacity out of range");
+
+public:
+    static constexpr int capacity() {
+        return N;
+    }
+
+    int size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    bool full() const {
+        return count == N;
+    }
+
+    void clear() {
+        head = 0;
+        count = 0;
+    }
+
+    T &front() {
+        return items[head];
+    }
+
+    const T &front() const {
+        return items[head];
+    }
+
+    T &back() {
+        return items[wrap(head + count - 1)];
+    }
+
+    const T &back() const {
+        return items[wrap(head + count - 1)];
+    }
+
+    // 第i个元素，0为队首
+    const T &operator[](int i) const {
+        return items[wrap(head + i)];
+    }
+
+    // 以下入队操作由调用者保证队列未满，出队操作由调用者保证队列非空
+    void push_back(const T &item) {
+        items[wrap(head + count)] = item;
+        count++;
+    }
+
+    void push_front(const T &item) {
+        head = (uint16_t) (head == 0 ? N - 1 : head - 1);
+        items[head] = item;
+        count++;
+    }
+
+    void pop_front() {
+        head = (uint16_t) wrap(head + 1);
+        count--;
+    }
+
+    void pop_back() {
+        count--;
+    }
+
+private:
+    T items[N] = {};
+    uint16_t head = 0;
+    uint16_t count = 0;
+
+    // 位置不超过2N-1，减一次即可回绕
+    static int wrap(int position) {
+        return position >= N ? position - N : position;
+    }
+};
+
+#endif //ZTE_COMMON_INLINE_RING_H
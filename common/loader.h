@@ -0,0 +1,240 @@
+#ifndef ZTE_COMMON_LOADER_H
+#define ZTE_COMMON_LOADER_H
+
+// flow.txt、port.txt、result.txt的公共读取器，求解程序与两个评测程序共用
+// 整个文件mmap到内存中，手写整数扫描直接从映射区解析，不经过string与stringstream
+
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// 只读映射整个文件；Windows下退化为一次性读入内存
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile() {
+        close();
+    }
+
+    bool open(const std::string &path) {
+        close();
+#ifdef _WIN32
+        std::ifstream input(path, std::ios::in | std::ios::binary);
+        if (!input.is_open()) {
+            return false;
+        }
+        buffer.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+        data = buffer.data();
+        size = buffer.size();
+        opened = true;
+        return true;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat s{};
+        if (fstat(fd, &s) != 0) {
+            ::close(fd);
+            return false;
+        }
+        size = (size_t) s.st_size;
+        // 空文件不能mmap，视为没有内容
+        if (size > 0) {
+            void *addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                ::close(fd);
+                size = 0;
+                return false;
+            }
+            madvise(addr, size, MADV_SEQUENTIAL);
+            data = (const char *) addr;
+        }
+        ::close(fd);
+        opened = true;
+        return true;
+#endif
+    }
+
+    void close() {
+#ifdef _WIN32
+        buffer.clear();
+#else
+        if (data != nullptr) {
+            munmap((void *) data, size);
+        }
+#endif
+        data = nullptr;
+        size = 0;
+        opened = false;
+    }
+
+    bool is_open() const {
+        return opened;
+    }
+
+    const char *begin() const {
+        return data;
+    }
+
+    const char *end() const {
+        return data + size;
+    }
+
+private:
+    const char *data = nullptr;
+    size_t size = 0;
+    bool opened = false;
+#ifdef _WIN32
+    std::string buffer;
+#endif
+};
+
+// 逐行读取逗号分隔的整数表
+// 兼容CRLF换行、末行没有换行、空行以及字段两侧的空白；遇到格式错误的行时停止，并记录行号
+class CsvFile {
+public:
+    bool open(const std::string &path, bool has_header) {
+        line = 0;
+        bad = 0;
+        if (!file.open(path)) {
+            return false;
+        }
+        cur = file.begin();
+        end = file.end();
+        if (has_header) {
+            skip_line();
+        }
+        return true;
+    }
+
+    // 剩余行数的上界，用于预分配数组
+    size_t row_hint() const {
+        size_t rows = 0;
+        const char *p = cur;
+        while (p < end) {
+            // memchr由libc做了向量化，找换行比逐字节扫描快得多
+            auto nl = (const char *) memchr(p, '\n', end - p);
+            rows++;
+            if (nl == nullptr) {
+                break;
+            }
+            p = nl + 1;
+        }
+        return rows;
+    }
+
+    // 读取下一个非空行的N个整数，文件结束或格式错误时返回false
+    template<int N>
+    bool next(int (&row)[N]) {
+        while (cur < end) {
+            auto nl = (const char *) memchr(cur, '\n', end - cur);
+            const char *line_end = nl == nullptr ? end : nl;
+            const char *p = cur;
+            cur = nl == nullptr ? end : nl + 1;
+            line++;
+            skip_blank(p, line_end);
+            if (p == line_end) {
+                // 空行（包括只有\r的行）
+                continue;
+            }
+            for (int i = 0; i < N; i++) {
+                if (i > 0) {
+                    if (p == line_end || *p != ',') {
+                        return fail();
+                    }
+                    p++;
+                    skip_blank(p, line_end);
+                }
+                if (!parse_int(p, line_end, row[i])) {
+                    return fail();
+                }
+                skip_blank(p, line_end);
+            }
+            if (p != line_end) {
+                return fail();
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // 是否因为格式错误而停止
+    bool failed() const {
+        return bad != 0;
+    }
+
+    // 格式错误的行号（不含表头，从1开始）
+    int bad_line() const {
+        return bad;
+    }
+
+private:
+    MappedFile file;
+    const char *cur = nullptr;
+    const char *end = nullptr;
+    int line = 0;
+    int bad = 0;
+
+    void skip_line() {
+        if (cur == end) {
+            return;
+        }
+        auto nl = (const char *) memchr(cur, '\n', end - cur);
+        cur = nl == nullptr ? end : nl + 1;
+    }
+
+    bool fail() {
+        bad = line;
+        cur = end;
+        return false;
+    }
+
+    static void skip_blank(const char *&p, const char *line_end) {
+        while (p < line_end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+            p++;
+        }
+    }
+
+    static bool parse_int(const char *&p, const char *line_end, int &value) {
+        bool negative = false;
+        if (p < line_end && (*p == '-' || *p == '+')) {
+            negative = *p == '-';
+            p++;
+        }
+        const char *digits = p;
+        long long v = 0;
+        while (p < line_end && (unsigned) (*p - '0') < 10) {
+            // int最多10位，读到第11位时立即视为格式错误，累加值不会溢出long long
+            if (p - digits == 10) {
+                return false;
+            }
+            v = v * 10 + (*p - '0');
+            p++;
+        }
+        // 10位以内仍可能超出int范围，同样视为格式错误
+        if (p == digits || v > (negative ? -(long long) INT_MIN : INT_MAX)) {
+            return false;
+        }
+        value = (int) (negative ? -v : v);
+        return true;
+    }
+};
+
+#endif //ZTE_COMMON_LOADER_H
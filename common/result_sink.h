@@ -0,0 +1,187 @@
+#ifndef ZTE_COMMON_RESULT_SINK_H
+#define ZTE_COMMON_RESULT_SINK_H
+
+// 调度决策的输出端：文本文件、二进制文件、内存三种实现，求解器只依赖ResultSink接口
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// 一个调度决策：流flow_id在send_time时刻发往端口port_id
+class Decision {
+public:
+    int flow_id;
+    int port_id;
+    int send_time;
+
+public:
+    Decision(int flow_id, int port_id, int send_time) {
+        this->flow_id = flow_id;
+        this->port_id = port_id;
+        this->send_time = send_time;
+    }
+};
+
+class ResultSink {
+public:
+    virtual ~ResultSink() = default;
+
+    // 记录一个调度决策
+    virtual void put(int flow_id, int port_id, int send_time) = 0;
+
+    // 记录一个被抛弃的流：发往排队区已满的端口，输出文件中与普通决策相同
+    virtual void discard(int flow_id, int port_id, int send_time) {
+        put(flow_id, port_id, send_time);
+    }
+
+    // 将缓冲的决策写出
+    virtual void flush() {}
+};
+
+// 大缓冲区写文件的基类，缓冲区满了才调用一次fwrite
+class BufferedFileSink : public ResultSink {
+public:
+    static const size_t BUFFER_SIZE = 1 << 20;
+
+    BufferedFileSink() {
+        buffer.resize(BUFFER_SIZE);
+    }
+
+    BufferedFileSink(const BufferedFileSink &) = delete;
+
+    BufferedFileSink &operator=(const BufferedFileSink &) = delete;
+
+    ~BufferedFileSink() override {
+        close();
+    }
+
+    bool open(const std::string &path, const char *mode) {
+        close();
+        failed = false;
+        file = fopen(path.c_str(), mode);
+        return file != nullptr;
+    }
+
+    bool is_open() const {
+        return file != nullptr;
+    }
+
+    // 写出失败（如磁盘已满）时记下错误，之后的写出照常进行，由close()返回
+    void flush() override {
+        if (file != nullptr && used > 0) {
+            if (fwrite(buffer.data(), 1, used, file) != used || fflush(file) != 0) {
+                failed = true;
+            }
+        }
+        used = 0;
+    }
+
+    // 关闭文件，返回自open以来的所有写出是否都成功
+    bool close() {
+        flush();
+        if (file != nullptr) {
+            if (fclose(file) != 0) {
+                failed = true;
+            }
+            file = nullptr;
+        }
+        return !failed;
+    }
+
+protected:
+    std::vector<char> buffer;
+    size_t used = 0;
+
+    // 保证缓冲区还有bytes字节空闲
+    char *reserve(size_t bytes) {
+        if (used + bytes > buffer.size()) {
+            flush();
+        }
+        return buffer.data() + used;
+    }
+
+private:
+    FILE *file = nullptr;
+    // 自open以来是否有写出失败
+    bool failed = false;
+};
+
+// result.txt格式的文本输出：每行"flow_id,port_id,send_time"
+class TextResultSink : public BufferedFileSink {
+public:
+    bool open(const std::string &path) {
+        return BufferedFileSink::open(path, "wb");
+    }
+
+    void put(int flow_id, int port_id, int send_time) override {
+        // 每个int最多11个字符，加两个逗号和换行
+        char *p = reserve(3 * 11 + 3);
+        char *start = p;
+        p = write_int(p, flow_id);
+        *p++ = ',';
+        p = write_int(p, port_id);
+        *p++ = ',';
+        p = write_int(p, send_time);
+        *p++ = '\n';
+        used += p - start;
+    }
+
+private:
+    // 手写整数格式化，避免ostream的locale与格式状态开销
+    static char *write_int(char *p, int value) {
+        unsigned int v = (unsigned int) value;
+        if (value < 0) {
+            *p++ = '-';
+            v = 0u - v;
+        }
+        char digits[10];
+        int n = 0;
+        do {
+            digits[n++] = char('0' + v % 10);
+            v /= 10;
+        } while (v != 0);
+        while (n > 0) {
+            *p++ = digits[--n];
+        }
+        return p;
+    }
+};
+
+// 紧凑的二进制输出：每个决策为三个小端int32（flow_id, port_id, send_time），没有文件头
+class BinaryResultSink : public BufferedFileSink {
+public:
+    bool open(const std::string &path) {
+        return BufferedFileSink::open(path, "wb");
+    }
+
+    void put(int flow_id, int port_id, int send_time) override {
+        char *p = reserve(3 * 4);
+        p = write_int32(p, flow_id);
+        p = write_int32(p, port_id);
+        write_int32(p, send_time);
+        used += 3 * 4;
+    }
+
+private:
+    static char *write_int32(char *p, int value) {
+        uint32_t v = (uint32_t) value;
+        for (int i = 0; i < 4; i++) {
+            *p++ = char(v >> (8 * i));
+        }
+        return p;
+    }
+};
+
+// 保存在内存中的输出，供进程内评分使用
+class MemoryResultSink : public ResultSink {
+public:
+    std::vector<Decision> decisions;
+
+public:
+    void put(int flow_id, int port_id, int send_time) override {
+        decisions.emplace_back(flow_id, port_id, send_time);
+    }
+};
+
+#endif //ZTE_COMMON_RESULT_SINK_H
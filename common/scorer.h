@@ -0,0 +1,472 @@
+#ifndef ZTE_COMMON_SCORER_H
+#define ZTE_COMMON_SCORER_H
+
+// 进程内评分库：给定流、端口与调度决策，按阶段一或阶段二的规则模拟并计算总用时
+// 两个评测程序与求解器共用，求解器可以直接对内存中的决策评分，不必先写result.txt再由评测程序读回
+// 决策确定后各端口的模拟互不影响，可以分给多个线程并行，最后合并总用时与溢出惩罚
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "cpu_clock.h"
+#include "inline_ring.h"
+#include "result_sink.h"
+
+// 端口排队区容量，阶段二中超出的流被丢弃
+const int PORT_QUEUE_LIMIT = 30;
+// 调度区容量为端口数的倍数
+const int POOL_SIZE_PER_PORT = 20;
+// 阶段二中被丢弃流的占用时间按此倍数计入总用时
+const int OVERFLOW_PENALTY = 2;
+
+class FlowInfo {
+public:
+    int id;
+    int bandwidth;
+    int coming_time;
+    int occupied_time;
+
+public:
+    FlowInfo(int id, int bandwidth, int coming_time, int occupied_time) {
+        this->id = id;
+        this->bandwidth = bandwidth;
+        this->coming_time = coming_time;
+        this->occupied_time = occupied_time;
+    }
+};
+
+class PortInfo {
+public:
+    int id;
+    int bandwidth;
+
+public:
+    PortInfo(int id, int bandwidth) {
+        this->id = id;
+        this->bandwidth = bandwidth;
+    }
+};
+
+// 评分失败的原因
+enum class ScoreError {
+    NONE,
+    // 决策数少于流数
+    MISSING_RESULTS,
+    // 流id不存在
+    BAD_FLOW_ID,
+    // 端口id不存在
+    BAD_PORT_ID,
+    // 发送时间早于流进入设备的时间
+    SEND_BEFORE_ARRIVAL,
+    // 流带宽大于端口最大带宽
+    BANDWIDTH_EXCEEDED,
+    // 流被重复发送
+    DUPLICATE_SEND,
+    // 调度区中的流超过容量（仅阶段二）
+    POOL_OVERFLOW,
+    // 有流未被发送
+    UNSENT_FLOW,
+};
+
+// 失败原因的简短英文名，用于日志与报告
+inline const char *score_error_name(ScoreError error) {
+    switch (error) {
+        case ScoreError::NONE:
+            return "ok";
+        case ScoreError::MISSING_RESULTS:
+            return "missing results";
+        case ScoreError::BAD_FLOW_ID:
+            return "bad flow id";
+        case ScoreError::BAD_PORT_ID:
+            return "bad port id";
+        case ScoreError::SEND_BEFORE_ARRIVAL:
+            return "sent before arrival";
+        case ScoreError::BANDWIDTH_EXCEEDED:
+            return "bandwidth exceeded";
+        case ScoreError::DUPLICATE_SEND:
+            return "duplicate send";
+        case ScoreError::POOL_OVERFLOW:
+            return "pool overflow";
+        case ScoreError::UNSENT_FLOW:
+            return "unsent flow";
+    }
+    return "unknown";
+}
+
+class Score {
+public:
+    ScoreError error = ScoreError::NONE;
+    // 出错的决策，error为BAD_FLOW_ID到DUPLICATE_SEND时有效
+    Decision culprit{-1, -1, -1};
+    // 未被发送的流id，error为UNSENT_FLOW时有效
+    int unsent_flow = -1;
+    // 总用时，阶段二已包含溢出惩罚；出错时为0
+    int makespan = 0;
+    // 阶段二中被丢弃流的加权时间
+    int overflow_penalty = 0;
+
+public:
+    bool ok() const {
+        return error == ScoreError::NONE;
+    }
+};
+
+// 评分时端口的模拟状态
+class ScorePort {
+public:
+    int max_bandwidth;
+    int bandwidth;
+    // 端口状态已经更新到的时刻
+    int update_time = -1;
+    // 正在发送的流的(发送完毕时刻, 带宽)，小根堆
+    std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>, std::greater<std::pair<int, int>>> sending;
+    // 排队区中的流在flows中的下标；阶段一的排队区不限长，其中只存放接下来的至多PORT_QUEUE_LIMIT个流
+    InlineRing<int, PORT_QUEUE_LIMIT> queue;
+    // 最后一次有流出排队区的时刻
+    int last_send_time = -1;
+    // 已发送流中最晚的发送完毕时刻
+    int max_finish_time = -1;
+    // 被丢弃流的占用时间之和（阶段二）
+    int overflow_time = 0;
+
+public:
+    explicit ScorePort(int bandwidth) {
+        this->max_bandwidth = bandwidth;
+        this->bandwidth = bandwidth;
+    }
+};
+
+// 评分过程：校验决策并模拟各端口
+class Scorer {
+public:
+    // 每个线程一次领取的端口数，端口不多时不值得开线程
+    static const int PORT_CHUNK = 64;
+
+    // threads为模拟端口的线程数
+    Scorer(const std::vector<FlowInfo> &flows, const std::vector<PortInfo> &ports,
+           const std::vector<Decision> &decisions, int threads = 1)
+            : flows(flows), ports(ports), decisions(decisions) {
+        this->threads = threads;
+    }
+
+    // 阶段一：端口排队区不限长，按决策顺序入队
+    Score stage1() {
+        Score score;
+        if (!prepare(score)) {
+            return score;
+        }
+        for (const auto &decision: decisions) {
+            if (!check(decision, score)) {
+                return score;
+            }
+            send(decision);
+        }
+        if (!check_unsent(score)) {
+            return score;
+        }
+        for_each_port([this](int p) {
+            simulate_stage1(sim_ports[p]);
+        });
+        int last_send_time = -1;
+        int max_finish_time = -1;
+        for (auto &port: sim_ports) {
+            last_send_time = std::max(last_send_time, port.last_send_time);
+            max_finish_time = std::max(max_finish_time, port.max_finish_time);
+        }
+        // 逐个时间单位模拟时，在所有排队区都为空后的下一个时间单位结束，结束时再加一
+        score.makespan = std::max(last_send_time + 2, max_finish_time);
+        return score;
+    }
+
+    // 阶段二：决策按发送时间入队，排队区超过PORT_QUEUE_LIMIT的流被丢弃并加权计时，调度区不能超过容量
+    Score stage2() {
+        Score score;
+        if (!prepare(score)) {
+            return score;
+        }
+        std::vector<int> order(decisions.size());
+        for (int i = 0; i < (int) order.size(); i++) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+            return decisions[a].send_time < decisions[b].send_time;
+        });
+        std::vector<int> arrivals(flows.size());
+        for (int i = 0; i < (int) arrivals.size(); i++) {
+            arrivals[i] = flows[i].coming_time;
+        }
+        std::sort(arrivals.begin(), arrivals.end());
+        // 按时间顺序校验决策并检查调度区：调度区中的流数即已到达流数减去已发送流数，只在有流到达或发送的时刻变化
+        int max_pool_size = (int) ports.size() * POOL_SIZE_PER_PORT;
+        int arrived_count = 0;
+        int sent_count = 0;
+        int time = 0;
+        int i = 0;
+        while (true) {
+            for (; i < (int) order.size() && decisions[order[i]].send_time <= time; i++) {
+                if (!check(decisions[order[i]], score)) {
+                    return score;
+                }
+                send(decisions[order[i]]);
+                sent_count++;
+            }
+            while (arrived_count < (int) arrivals.size() && arrivals[arrived_count] <= time) {
+                arrived_count++;
+            }
+            if (arrived_count - sent_count > max_pool_size) {
+                score.error = ScoreError::POOL_OVERFLOW;
+                return score;
+            }
+            if (i >= (int) order.size()) {
+                break;
+            }
+            time = decisions[order[i]].send_time;
+            if (arrived_count < (int) arrivals.size()) {
+                time = std::min(time, arrivals[arrived_count]);
+            }
+        }
+        if (!check_unsent(score)) {
+            return score;
+        }
+        // 各端口互不影响，分别模拟后合并
+        for_each_port([this](int p) {
+            simulate_stage2(sim_ports[p], port_sends[p]);
+        });
+        int last_send_time = time;
+        int max_finish_time = -1;
+        for (auto &port: sim_ports) {
+            last_send_time = std::max(last_send_time, port.last_send_time);
+            max_finish_time = std::max(max_finish_time, port.max_finish_time);
+            score.overflow_penalty += port.overflow_time * OVERFLOW_PENALTY;
+        }
+        score.makespan = std::max(last_send_time, max_finish_time) + score.overflow_penalty;
+        return score;
+    }
+
+private:
+    const std::vector<FlowInfo> &flows;
+    const std::vector<PortInfo> &ports;
+    const std::vector<Decision> &decisions;
+    int threads;
+    // 流id到flows下标的映射
+    std::vector<int> flow_index;
+    std::vector<bool> sent;
+    std::vector<int> send_time;
+    std::vector<ScorePort> sim_ports;
+    // 各端口按入队顺序收到的流
+    std::vector<std::vector<int>> port_sends;
+
+    // 对每个端口下标调用simulate，各线程按PORT_CHUNK个一组从共享计数器领取，端口负载不均时也能均衡
+    // simulate只能修改该端口自己的状态
+    void for_each_port(const std::function<void(int)> &simulate) {
+        int count = (int) sim_ports.size();
+        int workers = std::max(1, std::min(threads, (count + PORT_CHUNK - 1) / PORT_CHUNK));
+        if (workers == 1) {
+            for (int p = 0; p < count; p++) {
+                simulate(p);
+            }
+            return;
+        }
+        std::atomic<int> next(0);
+        auto worker = [&]() {
+            int begin;
+            while ((begin = next.fetch_add(PORT_CHUNK)) < count) {
+                for (int p = begin; p < std::min(count, begin + PORT_CHUNK); p++) {
+                    simulate(p);
+                }
+            }
+        };
+        std::vector<double> worker_cpu(workers, 0);
+        std::vector<std::thread> pool;
+        for (int t = 1; t < workers; t++) {
+            pool.emplace_back([&worker, &worker_cpu, t]() {
+                worker();
+                worker_cpu[t] = thread_cpu_seconds();
+            });
+        }
+        worker();
+        for (auto &thread: pool) {
+            thread.join();
+        }
+        // 工作线程的CPU时间不在调用线程的线程时钟里，记到调用线程名下
+        for (double seconds: worker_cpu) {
+            spawned_cpu_seconds += seconds;
+        }
+    }
+
+    bool prepare(Score &score) {
+        if (decisions.size() < flows.size()) {
+            score.error = ScoreError::MISSING_RESULTS;
+            return false;
+        }
+        flow_index.assign(flows.size(), -1);
+        for (int i = 0; i < (int) flows.size(); i++) {
+            if (flows[i].id >= 0 && flows[i].id < (int) flows.size()) {
+                flow_index[flows[i].id] = i;
+            }
+        }
+        sent.assign(flows.size(), false);
+        send_time.assign(flows.size(), -1);
+        sim_ports.clear();
+        for (const auto &port: ports) {
+            sim_ports.emplace_back(port.bandwidth);
+        }
+        port_sends.assign(ports.size(), std::vector<int>());
+        return true;
+    }
+
+    bool fail(ScoreError error, const Decision &decision, Score &score) {
+        score.error = error;
+        score.culprit = decision;
+        return false;
+    }
+
+    bool check(const Decision &decision, Score &score) {
+        if (decision.flow_id >= (int) flows.size() || decision.flow_id < 0 || flow_index[decision.flow_id] < 0) {
+            return fail(ScoreError::BAD_FLOW_ID, decision, score);
+        }
+        if (decision.port_id >= (int) ports.size() || decision.port_id < 0) {
+            return fail(ScoreError::BAD_PORT_ID, decision, score);
+        }
+        int flow = flow_index[decision.flow_id];
+        if (decision.send_time < flows[flow].coming_time) {
+            return fail(ScoreError::SEND_BEFORE_ARRIVAL, decision, score);
+        }
+        if (flows[flow].bandwidth > ports[decision.port_id].bandwidth) {
+            return fail(ScoreError::BANDWIDTH_EXCEEDED, decision, score);
+        }
+        if (sent[flow]) {
+            return fail(ScoreError::DUPLICATE_SEND, decision, score);
+        }
+        return true;
+    }
+
+    void send(const Decision &decision) {
+        int flow = flow_index[decision.flow_id];
+        sent[flow] = true;
+        send_time[flow] = decision.send_time;
+        port_sends[decision.port_id].push_back(flow);
+    }
+
+    bool check_unsent(Score &score) {
+        for (int i = 0; i < (int) flows.size(); i++) {
+            if (!sent[i]) {
+                score.error = ScoreError::UNSENT_FLOW;
+                score.unsent_flow = flows[i].id;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 更新端口在time时刻的状态：先释放发送完毕的流，再让排队区中已到发送时间的流依次发出
+    void update(ScorePort &port, int time) {
+        while (!port.sending.empty() && port.sending.top().first <= time) {
+            port.bandwidth += port.sending.top().second;
+            port.sending.pop();
+        }
+        dispatch(port, time);
+        port.update_time = time;
+    }
+
+    // 排队区中已到发送时间的流在time时刻依次发出，直到首流带宽不足；不释放带宽，
+    // 同一时刻发出的占用时间为0的流要到下一次更新才释放，因此同一时刻可以多次调用
+    void dispatch(ScorePort &port, int time) {
+        while (!port.queue.empty() && send_time[port.queue.front()] <= time) {
+            const FlowInfo &flow = flows[port.queue.front()];
+            if (flow.bandwidth > port.bandwidth) {
+                break;
+            }
+            port.sending.emplace(time + flow.occupied_time, flow.bandwidth);
+            port.max_finish_time = std::max(port.max_finish_time, time + flow.occupied_time);
+            port.bandwidth -= flow.bandwidth;
+            port.queue.pop_front();
+            port.last_send_time = time;
+        }
+    }
+
+    // 首流被带宽阻塞时，下一个可能发出的时刻是下一个流发送完毕的时刻
+    static int next_release(const ScorePort &port) {
+        return std::max(port.update_time + 1, port.sending.top().first);
+    }
+
+    // 阶段一的端口模拟：只在首流到达发送时间或有流发送完毕的时刻更新
+    // 排队区是port_sends[p]上的一个窗口，只有首流决定能否发出，窗口发空后补充再接着发出
+    void simulate_stage1(ScorePort &port) {
+        int p = (int) (&port - sim_ports.data());
+        const std::vector<int> &sends = port_sends[p];
+        size_t next = 0;
+        int time = 0;
+        while (true) {
+            update(port, time);
+            while (port.queue.empty() && next < sends.size()) {
+                for (; next < sends.size() && !port.queue.full(); next++) {
+                    port.queue.push_back(sends[next]);
+                }
+                dispatch(port, time);
+            }
+            if (port.queue.empty()) {
+                break;
+            }
+            int head_time = send_time[port.queue.front()];
+            time = head_time > time ? head_time : next_release(port);
+        }
+    }
+
+    // 阶段二的端口模拟：sends按发送时间有序，每个发送时刻先推进并更新端口，再依次入队，排队区满时丢弃
+    // 更新后排队区非空说明首流被阻塞，本时刻不会再有流发出，因此与全部入队、更新后从队尾丢弃到PORT_QUEUE_LIMIT个等价
+    void simulate_stage2(ScorePort &port, const std::vector<int> &sends) {
+        for (int i = 0; i < (int) sends.size();) {
+            int time = send_time[sends[i]];
+            while (!port.queue.empty() && !port.sending.empty() && next_release(port) < time) {
+                update(port, next_release(port));
+            }
+            update(port, time);
+            for (; i < (int) sends.size() && send_time[sends[i]] == time; i++) {
+                if (port.queue.full()) {
+                    port.overflow_time += flows[sends[i]].occupied_time;
+                    continue;
+                }
+                port.queue.push_back(sends[i]);
+                // 排队区原为空时新流即为首流，可能立即发出
+                if (port.queue.size() == 1) {
+                    dispatch(port, time);
+                }
+            }
+        }
+        // 把排队区的所有流都发送出去
+        while (!port.queue.empty()) {
+            update(port, next_release(port));
+        }
+    }
+};
+
+// threads为并行模拟端口的线程数，与评分结果无关
+inline Score score_stage1(const std::vector<FlowInfo> &flows, const std::vector<PortInfo> &ports,
+                          const std::vector<Decision> &decisions, int threads = 1) {
+    return Scorer(flows, ports, decisions, threads).stage1();
+}
+
+inline Score score_stage2(const std::vector<FlowInfo> &flows, const std::vector<PortInfo> &ports,
+                          const std::vector<Decision> &decisions, int threads = 1) {
+    return Scorer(flows, ports, decisions, threads).stage2();
+}
+
+// 理论最优用时：没有任何堵塞时，所有流的带宽×占用时间之和除以端口总带宽
+inline double best_time(const std::vector<FlowInfo> &flows, const std::vector<PortInfo> &ports) {
+    long long need_bandwidth = 0;
+    long long port_bandwidth = 0;
+    for (const auto &flow: flows) {
+        need_bandwidth += (long long) flow.bandwidth * flow.occupied_time;
+    }
+    for (const auto &port: ports) {
+        port_bandwidth += port.bandwidth;
+    }
+    return need_bandwidth / double(port_bandwidth);
+}
+
+#endif //ZTE_COMMON_SCORER_H
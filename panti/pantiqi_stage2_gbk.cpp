@@ -1,69 +1,19 @@
-#include<fstream>
 #include<iostream>
+#include<sstream>
 #include<vector>
 #include<string>
 #include<algorithm>
-#include<map>
-#include<limits.h>
-#include<deque>
 #include <iomanip>
 #include<cmath>
+#include "../common/loader.h"
+#include "../common/scorer.h"
+#include "../common/dataset_driver.h"
 using namespace std;
-class Flow
-{
-public:
-	int id;
-	int speed;
-	int begintime;
-	int sendtime;
-	int needtime;
-	bool issend;
-	Flow(int i, int s, int b, int n);
-};
-class Port
-{
-public:
-	int id;
-	int speed;
-	int maxspeed;
-	multimap<int, Flow> flowqueue;
-	deque<Flow> waitqueue;
-	Port(int i, int s);
-};
-class Result
-{
-public:
-	int flowid;
-	int portid;
-	int sendtime;
-	Result(int f, int p, int s);
-};
-Flow::Flow(int i, int s, int b, int n)
-{
-	id = i;
-	speed = s;
-	begintime = b;
-	needtime = n;
-	issend = false;
-	sendtime = -1;
-}
-Port::Port(int i, int s)
-{
-	id = i;
-	speed = s;
-	maxspeed = speed;
-}
-Result::Result(int f, int p, int s)
-{
-	flowid = f;
-	portid = p;
-	sendtime = s;
-}
 
 /*ݵ벿֣ļݶ봦*/
-bool Input(string path, vector<Flow>& flows, vector<Port>& ports, vector<Result>& results, int& maxcachesize)
+bool Input(string path, vector<FlowInfo>& flows, vector<PortInfo>& ports, vector<Decision>& results, ostream& log)
 {
-	ifstream input;
+	CsvFile input;
 	int allspeed = 0;
 	int alltime = 0;
 	int allportspeed = 0;
@@ -72,43 +22,42 @@ bool Input(string path, vector<Flow>& flows, vector<Port>& ports, vector<Result>
 	string path1 = path + "/flow.txt";
 	string path2 = path + "/port.txt";
 	string path3 = path + "/result.txt";
-	input.open(path1, ios::in);
-	if (!input.is_open())
+	if (!input.open(path1, true))
 		return false;
-	input.ignore(100, '\n');
 	/*flow*/
-	while (!input.eof())
+	flows.reserve(input.row_hint());
+	int flowrow[4];
+	while (input.next(flowrow))
 	{
-		Flow flow(-1, 0, 0, 0);
-		char t;
-		input >> flow.id >> t >> flow.speed >> t >> flow.begintime >> t >> flow.needtime;
-		if (flow.id == -1)
-			break;
-		allspeed += flow.speed;
-		alltime += flow.needtime;
+		FlowInfo flow(flowrow[0], flowrow[1], flowrow[2], flowrow[3]);
+		allspeed += flow.bandwidth;
+		alltime += flow.occupied_time;
 		++flowcount;
 		flows.push_back(flow);
 	}
-	input.close();
+	if (input.failed())
+	{
+		log << path1 << "" << input.bad_line() << "иʽ" << endl;
+		return false;
+	}
 	/*flow*/
-	input.open(path2, ios::in);
-	if (!input.is_open())
+	if (!input.open(path2, true))
 		return false;
-	input.ignore(100, '\n');
 	/*port*/
-	while (!input.eof())
+	ports.reserve(input.row_hint());
+	int portrow[2];
+	while (input.next(portrow))
 	{
-		Port port(-1, 0);
-		char t;
-		input >> port.id >> t >> port.maxspeed;
-		port.speed = port.maxspeed;
-		if (port.id == -1)
-			break;
-		allportspeed += port.speed;
+		PortInfo port(portrow[0], portrow[1]);
+		allportspeed += port.bandwidth;
 		++portcount;
 		ports.push_back(port);
 	}
-	input.close();
+	if (input.failed())
+	{
+		log << path2 << "" << input.bad_line() << "иʽ" << endl;
+		return false;
+	}
 	//cout << "ܺ    " << allspeed << endl;
 	//cout << "ռʱܺͣ" << alltime << endl;
 	//cout << "˿ڴܺ  " << allportspeed << endl;
@@ -119,237 +68,104 @@ bool Input(string path, vector<Flow>& flows, vector<Port>& ports, vector<Result>
 	//cout << "ռʱƽֵ" << alltime / double(flowcount) << endl;
 	//cout << endl;
 	/*port*/
-	input.open(path3, ios::in);
-	if (!input.is_open())
+	if (!input.open(path3, false))
 	{
-		cout << "Ҳļ" << endl;
+		log << "Ҳļ" << endl;
 		return false;
 	}
-
-	while (!input.eof())
+	results.reserve(input.row_hint());
+	int resrow[3];
+	while (input.next(resrow))
+		results.emplace_back(resrow[0], resrow[1], resrow[2]);
+	if (input.failed())
 	{
-		Result res(-1, -1, -1);
-		char t;
-		input >> res.flowid >> t >> res.portid >> t >> res.sendtime;
-		if (res.sendtime == -1)
-			break;
-		results.push_back(res);
+		log << path3 << "" << input.bad_line() << "иʽ" << endl;
+		return false;
 	}
-	maxcachesize = ports.size() * 20;
-	sort(flows.begin(), flows.end(), [](const Flow& x, const Flow& y) {return x.begintime < y.begintime; });
 	return true;
 }
-/*¶˿״̬*/
-void updateport(vector<Port>& ports, const int& time)
+/*ݴֹcommon/scorer.hthreadsΪģ˿ڵ߳*/
+int algorithm(const vector<FlowInfo>& flows, const vector<PortInfo>& ports, const vector<Decision>& res, int threads, ostream& log)
 {
-
-	for (auto& port : ports)//ÿ˿ڽд
+	Score score = score_stage2(flows, ports, res, threads);
+	const Decision& iter = score.culprit;
+	switch (score.error)
 	{
-		for (auto j = port.flowqueue.begin(); j != port.flowqueue.end();)//Զ˿ѷ͵Ƿ
-		{
-			if (j->first > time)//mapΪ Сֵڵǰʱʹûзϵ
-			{
-				break;
-			}
-			else//֮зϵ ռõĶ˿ڳ
-			{
-				port.speed += j->second.speed;//˿ڴԭȥ
-				port.flowqueue.erase(j);//ڻɾ
-				j = port.flowqueue.begin();
-			}
-		}
-		while (!port.waitqueue.empty() && port.waitqueue.front().sendtime <= time)//ÿ˿еȴзʱСڵڵǰʱһǷܷ
-		{
-			if (port.waitqueue.front().speed <= port.speed)//˿ʣռ㹻Է
-			{
-				port.flowqueue.insert(pair<int, Flow>(time + port.waitqueue.front().needtime, port.waitqueue.front()));//ѷͶ
-				port.speed -= port.waitqueue.front().speed;//˿ڿÿռȥҪռõĿռ
-				port.waitqueue.pop_front();//ȴ
-			}
-			else
-			{
-				break;
-			}
-		}
+	case ScoreError::NONE:
+		break;
+	case ScoreError::MISSING_RESULTS:
+		log << "ȱʧʽ" << endl;
+		break;
+	case ScoreError::BAD_FLOW_ID:
+		log << "idڣΪ" << iter.flow_id << ',' << iter.port_id << ',' << iter.send_time << endl;
+		break;
+	case ScoreError::BAD_PORT_ID:
+		log << "˿idڣΪ" << iter.flow_id << ',' << iter.port_id << ',' << iter.send_time << endl;
+		break;
+	case ScoreError::SEND_BEFORE_ARRIVAL:
+		log << "ʱСڽ豸ʱ䣬Ϊ" << iter.flow_id << ',' << iter.port_id << ',' << iter.send_time << endl;
+		break;
+	case ScoreError::BANDWIDTH_EXCEEDED:
+		log << "ڶ˿Ϊ" << iter.flow_id << ',' << iter.port_id << ',' << iter.send_time << endl;
+		break;
+	case ScoreError::DUPLICATE_SEND:
+		log << "ظͣΪ" << iter.flow_id << ',' << iter.port_id << ',' << iter.send_time << endl;
+		break;
+	case ScoreError::POOL_OVERFLOW:
+		log << "ˣ" << endl;
+		break;
+	case ScoreError::UNSENT_FLOW:
+		log << "δͣδ͵Ϊ" << score.unsent_flow << endl;
+		break;
 	}
-
-	//int maxtime = time;
-
-	//return maxtime;
+	return score.makespan;
 }
-/*˿ڶȨʱ*/
-int checkport(vector<Port>& ports)
+/*÷pantiqi_stage2 [data_root] [-j ߳]ݼ֣˳*/
+/*ݼ߳ʱ̷ָ߳ݼģ˿*/
+int main(int argc, char* argv[])
 {
-	int overflowtime = 0;
-	for (auto& port : ports)
+	string data_root = "../data";  // sim_data_stage2_fish_result
+	int threads = default_threads();
+	for (int i = 1; i < argc; ++i)
 	{
-		if (port.waitqueue.size() <= 30)
-			continue;
+		string arg = argv[i];
+		if (arg == "-j" && i + 1 < argc)
+			threads = max(1, atoi(argv[++i]));
 		else
-		{
-			while (port.waitqueue.size() > 30)
-			{
-				int i = port.waitqueue.size() - 1;
-				overflowtime += port.waitqueue[i].needtime;
-				port.waitqueue.erase(port.waitqueue.begin() + i);
-			}
-		}
+			data_root = arg;
 	}
-	return overflowtime * 2;//2Ȩʱ
-}
-/*ݴ*/
-int algorithm(vector<Flow>& flows, vector<Port>& ports, vector<Result>& res, int& maxcachesize)
-{
-
-	if (res.size() < flows.size())
+	vector<string> paths = list_datasets(data_root);
+	vector<char> loaded(paths.size());
+	vector<int> times(paths.size());
+	vector<double> bests(paths.size());
+	vector<string> logs(paths.size());
+	int port_threads = max(1, threads / max(1, (int)paths.size()));
+	run_datasets((int)paths.size(), threads, [&](int i)
 	{
-		cout << "ȱʧʽ" << endl;
-		return 0;
-	}
-	vector<int>flowid(flows.size());
-	for (int i = 0; i < flows.size(); ++i)
-	{
-		flowid[flows[i].id] = i;
-	}
-
-	int time = 0;
-	int resultid = 0;
-	int overflowtime = 0;
-	while (true)
-	{
-		for (; resultid < res.size(); ++resultid)
-		{
-			int t = res[resultid].sendtime;
-			if (t > time)//ǰûʱ
-				break;
-			if (res[resultid].flowid >= flows.size() || res[resultid].flowid < 0)
-			{
-				cout << "idڣΪ" << res[resultid].flowid << ',' << res[resultid].portid << ',' << t << endl;
-				return 0;
-			}
-			if (res[resultid].portid >= ports.size() || res[resultid].portid < 0)
-			{
-				cout << "˿idڣΪ" << res[resultid].flowid << ',' << res[resultid].portid << ',' << t << endl;
-				return 0;
-			}
-
-			Flow& flow = flows[flowid[res[resultid].flowid]];
-			Port& port = ports[res[resultid].portid];
-			if (t < flow.begintime)
-			{
-				cout << "ʱСڽ豸ʱ䣬Ϊ" << res[resultid].flowid << ',' << res[resultid].portid << ',' << t << endl;
-				return 0;
-			}
-			if (flow.speed > port.maxspeed)
-			{
-				cout << "ڶ˿Ϊ" << res[resultid].flowid << ',' << res[resultid].portid << ',' << t << endl;
-				return 0;
-			}
-			if (flow.issend)
-			{
-				cout << "ظͣΪ" << res[resultid].flowid << ',' << res[resultid].portid << ',' << t << endl;
-				return 0;
-			}
-			flow.sendtime = t;
-			port.waitqueue.push_back(flow);
-			flow.issend = true;
-		}
-
-
-		updateport(ports, time);
-		overflowtime += checkport(ports);
-		int count = 0;
-		for (const auto& flow : flows)
-		{
-			if (flow.begintime > time)
-				break;
-			if (!flow.issend)
-			{
-				++count;
-			}
-		}
-		if (count > maxcachesize)
-		{
-			cout << "ˣ" << endl;
-			return 0;
-		}
-		if (resultid >= res.size())
-			break;
-		++time;
-	}
-	while (true)//Ŷͳȥ
-	{
-		int count = 0;
-		for (const auto& port : ports)
+		vector<FlowInfo> flows;
+		vector<PortInfo> ports;
+		vector<Decision> res;
+		ostringstream log;
+		loaded[i] = Input(paths[i], flows, ports, res, log);
+		if (loaded[i])
 		{
-			if (port.waitqueue.empty())
-				++count;
+			times[i] = algorithm(flows, ports, res, port_threads, log);  // һݼ
+			bests[i] = best_time(flows, ports);
 		}
-		if (count == ports.size())
-			break;
-		++time;
-		updateport(ports, time);
-	}
-
-	for (const auto& flow : flows)
-	{
-		if (!flow.issend)
-		{
-			cout << "δͣδ͵Ϊ" << flow.id << endl;
-			return 0;
-		}
-	}
-	int maxtime = time;
-
-	for (auto& port : ports)//ж˿ѷ͵ĶУҵϵʱ䲢
-	{
-		if (port.flowqueue.empty())
-			continue;
-		else
-		{
-			auto last = port.flowqueue.end();
-			--last;
-			maxtime = max(maxtime, last->first);
-		}
-	}
-
-	maxtime += overflowtime;
-	return maxtime;
-}
-double best(vector<Flow>& flows, vector<Port>& ports)
-{
-	long long int needspeed = 0;
-	long long int cansendspeed = 0;
-	for (int i = 0; i < flows.size(); ++i)
-	{
-		needspeed += (long long int)flows[i].speed * flows[i].needtime;
-	}
-	for (int i = 0; i < ports.size(); ++i)
-	{
-		cansendspeed += ports[i].maxspeed;
-	}
-	return needspeed / double(cansendspeed);
-}
-int main()
-{
+		logs[i] = log.str();
+	});
 	int No = 0;
-	vector<Flow> flows;
-	vector<Port> ports;
-	vector<Result> res;
 	int alltime = 0;
 	double allbest = 0;
 	double score = 0;
 	double bestscore = 0;
-	int maxcachesize = 0;
-	string path;
-	while (true)
+	for (; No < (int)paths.size(); ++No)
 	{
-		path = "../data/" + to_string(No);  // sim_data_stage2_fish_result
-		if (!Input(path, flows, ports, res, maxcachesize))
+		cout << logs[No];
+		if (!loaded[No])
 			break;
-		stable_sort(res.begin(), res.end(), [](const Result& x, const Result& y) {return x.sendtime < y.sendtime; });
-		int thistime = algorithm(flows, ports, res, maxcachesize);  // һݼ
-		double thisbest = best(flows, ports);
+		int thistime = times[No];
+		double thisbest = bests[No];
 		alltime += thistime;
 		allbest += thisbest;
 		cout << "" << No << "ļ"<<endl;
@@ -360,10 +176,6 @@ int main()
 		cout << endl;
 		score += 300 / (log(thistime) / log(10));
 		bestscore += 300 / (log(thisbest) / log(10));
-		++No;
-		flows.clear();
-		ports.clear();
-		res.clear();
 	}
 	//cout << "ܺţ" << allbest << endl;
 	//cout << "ܺʵʽ" << alltime << endl;
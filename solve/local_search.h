@@ -0,0 +1,410 @@
+#ifndef ZTE_SOLVE_LOCAL_SEARCH_H
+#define ZTE_SOLVE_LOCAL_SEARCH_H
+
+// 调度结果的局部搜索：在墙上时间预算内反复尝试把一个流改发到另一个端口、或提前发送，阶段二总用时不变大就接受
+// 两种移动都不会让调度区超过容量：改端口不改变发送时间，提前发送只会让调度区中的流更少
+// 每次移动只重新模拟受影响的端口，并且从移动时刻之前端口最后一次空闲的时刻开始，
+// 模拟到移动时刻之后端口再次空闲、且此后与原来的模拟完全一致时即停止，其余部分直接沿用原来的结果
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <functional>
+#include <map>
+#include <queue>
+#include <random>
+#include <set>
+#include <vector>
+#include "../common/scorer.h"
+
+class LocalSearch {
+public:
+    // 已尝试与已接受的移动数
+    long long tried_moves = 0;
+    long long accepted_moves = 0;
+
+public:
+    LocalSearch(const std::vector<FlowInfo> &flows, const std::vector<PortInfo> &ports)
+            : flows(flows), ports(ports) {
+    }
+
+    // 在budget秒内改进decisions（须是阶段二的合法调度），按改进后的结果重写decisions，返回阶段二总用时
+    // decisions不合法或流id不是0..n-1时不做任何改动，返回-1
+    int run(std::vector<Decision> &decisions, double budget, unsigned seed = 1) {
+        if (!score_stage2(flows, ports, decisions).ok() || !load(decisions)) {
+            return -1;
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(budget);
+        std::mt19937 rng(seed);
+        while (true) {
+            // 每64次移动看一次时钟
+            if ((tried_moves & 63) == 0 && std::chrono::steady_clock::now() >= deadline) {
+                break;
+            }
+            try_move(rng);
+        }
+        store(decisions);
+        return makespan();
+    }
+
+private:
+    // 端口的一次发送
+    class Send {
+    public:
+        int time;
+        int flow;
+    };
+
+    // 端口在第index次发送所在的发送时刻time之前处于空闲状态（排队区为空、所有流都已发送完毕），
+    // 从这里开始模拟只需要此前的累计量
+    class Checkpoint {
+    public:
+        int index;
+        int time;
+        long long overflow_time;
+        int last_send_time;
+        int max_finish_time;
+    };
+
+    // 一个端口的模拟结果
+    class PortRun {
+    public:
+        std::vector<Checkpoint> checkpoints;
+        long long overflow_time = 0;
+        int last_send_time = -1;
+        int max_finish_time = -1;
+
+        int end() const {
+            return std::max(last_send_time, max_finish_time);
+        }
+    };
+
+    // 一次试探的模拟结果：从原检查点start起新的检查点，以及可能沿用的原检查点（splice起，下标平移shift，溢出平移delta）
+    class Trial : public PortRun {
+    public:
+        int start = 0;
+        int splice = -1;
+        int shift = 0;
+        long long delta = 0;
+    };
+
+    class SimPort {
+    public:
+        // 按(发送时刻, 入队顺序)排列
+        std::vector<Send> sends;
+        PortRun run;
+    };
+
+    const std::vector<FlowInfo> &flows;
+    const std::vector<PortInfo> &ports;
+    std::vector<SimPort> sim_ports;
+    std::vector<int> flow_port;
+    std::vector<int> flow_time;
+    // 各发送时刻的决策数，最大的发送时刻即阶段二调度区检查结束的时刻
+    std::map<int, int> send_times;
+    // (端口结束时刻, 端口下标)
+    std::set<std::pair<int, int>> port_ends;
+    long long overflow_time = 0;
+    // 模拟用的临时状态，避免每次移动重新分配
+    std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>, std::greater<std::pair<int, int>>>
+            sending;
+    InlineRing<int, PORT_QUEUE_LIMIT> queue;
+    Trial trials[2];
+
+    bool load(const std::vector<Decision> &decisions) {
+        int n = (int) flows.size();
+        if (n == 0) {
+            return false;
+        }
+        for (int i = 0; i < n; i++) {
+            if (flows[i].id != i) {
+                return false;
+            }
+        }
+        sim_ports.assign(ports.size(), SimPort());
+        flow_port.assign(n, -1);
+        flow_time.assign(n, -1);
+        // 与评分一致：按发送时刻稳定排序后依次入队
+        std::vector<int> order(decisions.size());
+        for (int i = 0; i < (int) order.size(); i++) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&decisions](int a, int b) {
+            return decisions[a].send_time < decisions[b].send_time;
+        });
+        for (auto i: order) {
+            const Decision &decision = decisions[i];
+            sim_ports[decision.port_id].sends.push_back(Send{decision.send_time, decision.flow_id});
+            flow_port[decision.flow_id] = decision.port_id;
+            flow_time[decision.flow_id] = decision.send_time;
+            send_times[decision.send_time]++;
+        }
+        for (int p = 0; p < (int) sim_ports.size(); p++) {
+            // 第一个检查点是模拟开始之前
+            trials[0].start = 0;
+            simulate(p, Checkpoint{0, INT_MIN, 0, -1, -1}, INT_MAX, 0, trials[0]);
+            commit(p, trials[0]);
+            overflow_time += sim_ports[p].run.overflow_time;
+            port_ends.emplace(sim_ports[p].run.end(), p);
+        }
+        return true;
+    }
+
+    // 按(发送时刻, 端口, 端口内顺序)写回，评分时稳定排序后各端口的入队顺序不变
+    void store(std::vector<Decision> &decisions) const {
+        decisions.clear();
+        std::vector<std::pair<std::pair<int, int>, int>> order;
+        for (int p = 0; p < (int) sim_ports.size(); p++) {
+            for (int i = 0; i < (int) sim_ports[p].sends.size(); i++) {
+                order.emplace_back(std::make_pair(sim_ports[p].sends[i].time, p), i);
+            }
+        }
+        std::sort(order.begin(), order.end());
+        for (auto &item: order) {
+            int p = item.first.second;
+            const Send &send = sim_ports[p].sends[item.second];
+            decisions.emplace_back(send.flow, ports[p].id, send.time);
+        }
+    }
+
+    int makespan() const {
+        int end = std::max(send_times.rbegin()->first, port_ends.rbegin()->first);
+        return (int) (end + overflow_time * OVERFLOW_PENALTY);
+    }
+
+    // 按阶段二的规则从检查点from起模拟端口p，结果写入out
+    // 时刻changed_until之后的发送与原来的发送表一一对应、下标相差shift；
+    // 在此之后端口空闲、且原来的模拟在同一时刻同一位置也空闲时，后面的模拟必然相同，记下拼接位置即可停止
+    void simulate(int p, Checkpoint from, int changed_until, int shift, Trial &out) {
+        const std::vector<Checkpoint> &old = sim_ports[p].run.checkpoints;
+        const std::vector<Send> &sends = sim_ports[p].sends;
+        out.checkpoints.assign(1, from);
+        out.splice = -1;
+        out.overflow_time = from.overflow_time;
+        out.last_send_time = from.last_send_time;
+        out.max_finish_time = from.max_finish_time;
+        int max_bandwidth = ports[p].bandwidth;
+        int bandwidth = max_bandwidth;
+        int update_time = -1;
+        while (!sending.empty()) {
+            sending.pop();
+        }
+        queue.clear();
+        // 只发出不释放，与评分的Scorer::dispatch相同
+        auto dispatch = [&](int time) {
+            while (!queue.empty()) {
+                const FlowInfo &flow = flows[queue.front()];
+                if (flow.bandwidth > bandwidth) {
+                    break;
+                }
+                sending.emplace(time + flow.occupied_time, flow.bandwidth);
+                out.max_finish_time = std::max(out.max_finish_time, time + flow.occupied_time);
+                bandwidth -= flow.bandwidth;
+                queue.pop_front();
+                out.last_send_time = time;
+            }
+        };
+        auto update = [&](int time) {
+            while (!sending.empty() && sending.top().first <= time) {
+                bandwidth += sending.top().second;
+                sending.pop();
+            }
+            dispatch(time);
+            update_time = time;
+        };
+        auto next_release = [&]() {
+            return std::max(update_time + 1, sending.top().first);
+        };
+        for (int i = from.index; i < (int) sends.size();) {
+            int time = sends[i].time;
+            if (i > from.index && queue.empty() && out.max_finish_time <= time) {
+                // 空闲：记下检查点，看能否与原来的模拟拼接
+                while (!sending.empty()) {
+                    sending.pop();
+                }
+                bandwidth = max_bandwidth;
+                if (time > changed_until) {
+                    auto it = std::lower_bound(old.begin(), old.end(), time,
+                                               [](const Checkpoint &c, int t) { return c.time < t; });
+                    if (it != old.end() && it->time == time && it->index + shift == i) {
+                        // 其后的发送都在此之后，最后发送与发送完毕的时刻不变，只有溢出累计量平移
+                        out.splice = (int) (it - old.begin());
+                        out.shift = shift;
+                        out.delta = out.overflow_time - it->overflow_time;
+                        out.overflow_time = sim_ports[p].run.overflow_time + out.delta;
+                        out.last_send_time = sim_ports[p].run.last_send_time;
+                        out.max_finish_time = sim_ports[p].run.max_finish_time;
+                        return;
+                    }
+                }
+                out.checkpoints.push_back(Checkpoint{i, time, out.overflow_time, out.last_send_time,
+                                                     out.max_finish_time});
+            }
+            while (!queue.empty() && !sending.empty() && next_release() < time) {
+                update(next_release());
+            }
+            // 与评分相同：先更新，再依次入队，排队区满时丢弃
+            update(time);
+            for (; i < (int) sends.size() && sends[i].time == time; i++) {
+                if (queue.full()) {
+                    out.overflow_time += flows[sends[i].flow].occupied_time;
+                    continue;
+                }
+                queue.push_back(sends[i].flow);
+                if (queue.size() == 1) {
+                    dispatch(time);
+                }
+            }
+        }
+        while (!queue.empty()) {
+            update(next_release());
+        }
+    }
+
+    // 接受试探结果：原检查点start之前的保留，接上新的检查点与沿用的原检查点
+    void commit(int p, const Trial &trial) {
+        PortRun &run = sim_ports[p].run;
+        std::vector<Checkpoint> reused;
+        if (trial.splice >= 0) {
+            reused.assign(run.checkpoints.begin() + trial.splice, run.checkpoints.end());
+            for (auto &checkpoint: reused) {
+                checkpoint.index += trial.shift;
+                checkpoint.overflow_time += trial.delta;
+            }
+        }
+        run.checkpoints.resize(trial.start);
+        run.checkpoints.insert(run.checkpoints.end(), trial.checkpoints.begin(), trial.checkpoints.end());
+        run.checkpoints.insert(run.checkpoints.end(), reused.begin(), reused.end());
+        run.overflow_time = trial.overflow_time;
+        run.last_send_time = trial.last_send_time;
+        run.max_finish_time = trial.max_finish_time;
+    }
+
+    // 最后一个时刻不晚于time的检查点
+    static int checkpoint_before(const PortRun &run, int time) {
+        auto it = std::upper_bound(run.checkpoints.begin(), run.checkpoints.end(), time,
+                                   [](int t, const Checkpoint &c) { return t < c.time; });
+        return (int) (it - run.checkpoints.begin()) - 1;
+    }
+
+    // 流flow在端口发送表中的位置
+    int position(int p, int flow) const {
+        const std::vector<Send> &sends = sim_ports[p].sends;
+        auto it = std::lower_bound(sends.begin(), sends.end(), flow_time[flow],
+                                   [](const Send &s, int t) { return s.time < t; });
+        while (it->flow != flow) {
+            ++it;
+        }
+        return (int) (it - sends.begin());
+    }
+
+    // 把流加到端口发送表中time时刻的末尾，返回位置
+    int insert(int p, int flow, int time) {
+        std::vector<Send> &sends = sim_ports[p].sends;
+        auto it = std::upper_bound(sends.begin(), sends.end(), time,
+                                   [](int t, const Send &s) { return t < s.time; });
+        it = sends.insert(it, Send{time, flow});
+        return (int) (it - sends.begin());
+    }
+
+    // 从端口p在time之前最后一个检查点起重新模拟
+    void resimulate(int p, int time, int changed_until, int shift, Trial &out) {
+        const PortRun &run = sim_ports[p].run;
+        out.start = checkpoint_before(run, time);
+        simulate(p, run.checkpoints[out.start], changed_until, shift, out);
+    }
+
+    void try_move(std::mt19937 &rng) {
+        tried_moves++;
+        int n = (int) flows.size();
+        if (n == 0) {
+            return;
+        }
+        // 一半的移动针对结束最晚的端口上的流
+        int flow;
+        if (rng() & 1) {
+            const std::vector<Send> &sends = sim_ports[port_ends.rbegin()->second].sends;
+            if (sends.empty()) {
+                return;
+            }
+            flow = sends[rng() % sends.size()].flow;
+        } else {
+            flow = (int) (rng() % n);
+        }
+        int from = flow_port[flow];
+        int time = flow_time[flow];
+        bool earlier = (rng() & 1) && time > flows[flow].coming_time;
+        if (earlier) {
+            int gap = time - flows[flow].coming_time;
+            // 多数移动只提前几个时间单位，少数直接提前到任意时刻
+            int new_time = (rng() & 3) ? time - 1 - (int) (rng() % std::min(gap, 16)) :
+                           flows[flow].coming_time + (int) (rng() % gap);
+            move(flow, from, time, from, new_time);
+        } else {
+            int to = (int) (rng() % ports.size());
+            if (to == from || ports[to].bandwidth < flows[flow].bandwidth) {
+                return;
+            }
+            move(flow, from, time, to, time);
+        }
+    }
+
+    // 把流从端口from的time时刻移到端口to的new_time时刻，总用时不变大则接受，否则撤销
+    void move(int flow, int from, int time, int to, int new_time) {
+        int old_makespan = makespan();
+        int old_position = position(from, flow);
+        std::vector<Send> &from_sends = sim_ports[from].sends;
+        from_sends.erase(from_sends.begin() + old_position);
+        insert(to, flow, new_time);
+        send_times[new_time]++;
+        if (--send_times[time] == 0) {
+            send_times.erase(time);
+        }
+        flow_time[flow] = new_time;
+        int changed = std::max(time, new_time);
+        long long new_overflow = overflow_time;
+        if (from == to) {
+            resimulate(from, std::min(time, new_time), changed, 0, trials[0]);
+            new_overflow += trials[0].overflow_time - sim_ports[from].run.overflow_time;
+            port_ends.erase({sim_ports[from].run.end(), from});
+            port_ends.emplace(trials[0].end(), from);
+        } else {
+            resimulate(from, time, changed, -1, trials[0]);
+            resimulate(to, time, changed, 1, trials[1]);
+            new_overflow += trials[0].overflow_time - sim_ports[from].run.overflow_time;
+            new_overflow += trials[1].overflow_time - sim_ports[to].run.overflow_time;
+            port_ends.erase({sim_ports[from].run.end(), from});
+            port_ends.erase({sim_ports[to].run.end(), to});
+            port_ends.emplace(trials[0].end(), from);
+            port_ends.emplace(trials[1].end(), to);
+        }
+        std::swap(overflow_time, new_overflow);
+        if (makespan() <= old_makespan) {
+            accepted_moves++;
+            flow_port[flow] = to;
+            commit(from, trials[0]);
+            if (from != to) {
+                commit(to, trials[1]);
+            }
+            return;
+        }
+        // 撤销
+        overflow_time = new_overflow;
+        port_ends.erase({trials[0].end(), from});
+        port_ends.emplace(sim_ports[from].run.end(), from);
+        if (from != to) {
+            port_ends.erase({trials[1].end(), to});
+            port_ends.emplace(sim_ports[to].run.end(), to);
+        }
+        std::vector<Send> &to_sends = sim_ports[to].sends;
+        to_sends.erase(to_sends.begin() + position(to, flow));
+        flow_time[flow] = time;
+        from_sends.insert(from_sends.begin() + old_position, Send{time, flow});
+        send_times[time]++;
+        if (--send_times[new_time] == 0) {
+            send_times.erase(new_time);
+        }
+    }
+};
+
+#endif //ZTE_SOLVE_LOCAL_SEARCH_H
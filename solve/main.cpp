@@ -1,354 +1,386 @@
 #pragma GCC optimize(3)
 #pragma GCC optimize("inline")
 
-#include "ctime"
 #include <iostream>
-#include <sstream>
 #include <algorithm>
 #include "string"
 #include "vector"
-#include "sys/stat.h"
-#include "fstream"
 #include "map"
 #include "set"
 #include "queue"
-#include "list"
-
-// 调度区最大容量
-int MAX_POOL_SIZE;
+#include "climits"
+#include "memory"
+#include "limits"
+#include "fstream"
+#include "sstream"
+#include "../common/dataset_driver.h"
+#include "solver.h"
+#include "local_search.h"
 
-class Flow {
-public:
-    int id;
-    int bandwidth;
-    int coming_time;
-    int occupied_time; // 在端口上的占用时间
-    int send_time; // 发送时间
-    int send_port; // 发送端口
-public:
-    Flow(int id, int bandwidth, int coming_time, int occupied_time) {
-        this->id = id;
-        this->bandwidth = bandwidth;
-        this->coming_time = coming_time;
-        this->occupied_time = occupied_time;
-        this->send_time = -1;
-        this->send_port = -1;
+// 按一个参数的各个取值展开网格
+template<typename Value, typename Setter>
+void expand_grid(std::vector<SolveConfig> &grid, const std::vector<Value> &values, Setter set) {
+    std::vector<SolveConfig> expanded;
+    expanded.reserve(grid.size() * values.size());
+    for (auto &config: grid) {
+        for (Value value: values) {
+            expanded.push_back(config);
+            set(expanded.back(), value);
+        }
     }
-};
+    grid.swap(expanded);
+}
 
-class Port {
-public:
-    int id;
-    // 端口的最大（初始）带宽
-    int max_bandwidth;
-    // 端口的当前空闲带宽
-    int bandwidth_capacity;
-    // list of (remaining_time, bandwidth)
-    // 储存了端口中已发送的每个flow的剩余时间和带宽
-    std::list<std::pair<int, int>> occupies;
-    // 端口的排队区
-    std::queue<Flow> wait_queue;
+// 自动调参的参数网格，每个参数的第一个取值都是默认值，因此第0个是默认参数
+std::vector<SolveConfig> autotune_grid() {
+    std::vector<SolveConfig> grid(1);
+    expand_grid(grid, std::vector<FlowOrder>{FlowOrder::OCCUPIED_THEN_BANDWIDTH, FlowOrder::BANDWIDTH_THEN_OCCUPIED,
+                                             FlowOrder::INPUT},
+                [](SolveConfig &config, FlowOrder value) { config.flow_order = value; });
+    expand_grid(grid, std::vector<int>{POOL_SIZE_PER_PORT, POOL_SIZE_PER_PORT * 3 / 4},
+                [](SolveConfig &config, int value) { config.pool_factor = value; });
+    expand_grid(grid, std::vector<int>{PORT_QUEUE_LIMIT, PORT_QUEUE_LIMIT * 2 / 3},
+                [](SolveConfig &config, int value) { config.port_queue_cap = value; });
+    expand_grid(grid, std::vector<double>{1.0, 0.8, 1.5, std::numeric_limits<double>::infinity()},
+                [](SolveConfig &config, double value) { config.discard_ratio = value; });
+    expand_grid(grid, std::vector<int>{5, 10},
+                [](SolveConfig &config, int value) { config.see_num_changed = value; });
+    expand_grid(grid, std::vector<int>{1, 3},
+                [](SolveConfig &config, int value) { config.see_num_unchanged = value; });
+    expand_grid(grid, std::vector<bool>{true, false},
+                [](SolveConfig &config, bool value) { config.fill_freed_ports = value; });
+    expand_grid(grid, std::vector<bool>{false, true},
+                [](SolveConfig &config, bool value) { config.batch_admission = value; });
+    return grid;
+}
 
-public:
-    Port(int id, int bandwidth_capacity) {
-        this->id = id;
-        this->max_bandwidth = bandwidth_capacity;
-        this->bandwidth_capacity = bandwidth_capacity;
-    }
-};
+// 组合策略：各放置、排序与批量装箱策略各一组，第0个是默认的最佳适配
+std::vector<SolveConfig> portfolio_grid() {
+    std::vector<SolveConfig> grid(5);
+    // 最差适配
+    grid[1].placement = Placement::WORST_FIT;
+    // 最早结束的端口
+    grid[2].placement = Placement::EARLIEST_FINISH;
+    // 同时到达的流中带宽大的先调度
+    grid[3].flow_order = FlowOrder::BANDWIDTH_THEN_OCCUPIED;
+    // 同时到达的流一起按带宽降序装箱
+    grid[4].batch_admission = true;
+    return grid;
+}
 
-void read_files(const std::string &data_path, std::vector<Flow> &flows, std::vector<Port> &ports) {
-    // 读取flows.txt
-    std::ifstream file(data_path + "/flow.txt");
-    std::string line;
-    if (file.is_open()) {
-        // 跳过首行
-        std::getline(file, line);
-        while (std::getline(file, line)) {
-            // 读取一行
-            std::string id, bandwidth, coming_time, process_time;
-            std::stringstream ss(line);
-            std::getline(ss, id, ',');
-            std::getline(ss, bandwidth, ',');
-            std::getline(ss, coming_time, ',');
-            std::getline(ss, process_time);
-            // 添加到flows
-            flows.emplace_back(std::stoi(id), std::stoi(bandwidth), std::stoi(coming_time), std::stoi(process_time));
-        }
-        file.close();
-    }
-    // 读取ports.txt
-    file.open(data_path + "/port.txt");
-    if (file.is_open()) {
-        // 跳过首行
-        std::getline(file, line);
-        while (std::getline(file, line)) {
-            // 读取一行
-            std::string id, bandwidth_capacity;
-            std::stringstream ss(line);
-            std::getline(ss, id, ',');
-            std::getline(ss, bandwidth_capacity);
-            // 添加到ports
-            ports.emplace_back(std::stoi(id), std::stoi(bandwidth_capacity));
-        }
-        file.close();
+const char *placement_name(Placement placement) {
+    switch (placement) {
+        case Placement::BEST_FIT:
+            return "best_fit";
+        case Placement::WORST_FIT:
+            return "worst_fit";
+        case Placement::EARLIEST_FINISH:
+            return "earliest_finish";
     }
+    return "unknown";
 }
 
-//ports排序按照bandwidth_capacity升序
-class ports_queue_cmp {
-public:
-    bool operator()(const Port &a, const Port &b) const {
-        return a.bandwidth_capacity < b.bandwidth_capacity;
+const char *flow_order_name(FlowOrder flow_order) {
+    switch (flow_order) {
+        case FlowOrder::OCCUPIED_THEN_BANDWIDTH:
+            return "occupied_then_bandwidth";
+        case FlowOrder::BANDWIDTH_THEN_OCCUPIED:
+            return "bandwidth_then_occupied";
+        case FlowOrder::INPUT:
+            return "input";
     }
-};
+    return "unknown";
+}
 
-// wait_queue的排序仿函数
-class wait_queue_cmp {
-public:
-    bool operator()(const Flow &a, const Flow &b) const {
-        return a.occupied_time < b.occupied_time;
-    }
-};
+// 报告中的一列参数，逗号分隔
+std::string config_fields(const SolveConfig &config) {
+    std::ostringstream fields;
+    fields << config.pool_factor << ',' << config.see_num_changed << ',' << config.see_num_unchanged << ','
+           << config.discard_ratio << ',' << config.port_queue_cap << ',' << flow_order_name(config.flow_order) << ','
+           << config.fill_freed_ports << ',' << placement_name(config.placement) << ',' << config.batch_admission;
+    return fields.str();
+}
 
-// 遍历端口，更新带宽容量与排队区
-void update_ports(std::multiset<Port, ports_queue_cmp> &ports_queue, bool &bandwidth_changed) {
-    // 将ports_queue中的端口暂存到临时列表中
-    std::vector<Port> temp_ports;
-    for (auto &port: ports_queue) {
-        temp_ports.emplace_back(port);
-    }
-    // 清空ports_queue
-    ports_queue.clear();
-    for (auto &port: temp_ports) {
-        // 遍历port的occupies
-        for (auto it = port.occupies.begin(); it != port.occupies.end();) {
-            if (it->first > 0) {
-                it->first--;
-                it++;
-            } else {
-                port.bandwidth_capacity += it->second;
-                it = port.occupies.erase(it);
-                bandwidth_changed = true;
-            }
-        }
-        // 若port排队区非空，且排队首元素带宽小于此时端口带宽容量，发出
-        if (!port.wait_queue.empty()) {
-            Flow first_flow = port.wait_queue.front();
-            if (first_flow.bandwidth <= port.bandwidth_capacity) {
-                // 更新port的带宽容量
-                port.bandwidth_capacity -= first_flow.bandwidth;
-                // 更新port的occupies
-                port.occupies.emplace_back(first_flow.occupied_time, first_flow.bandwidth);
-                port.wait_queue.pop();
-            }
-        }
-        ports_queue.insert(port);
-    }
+// 数据集目录下的结果文件路径
+std::string result_path(const std::string &data_path, bool binary) {
+    return data_path + (binary ? "/result.bin" : "/result.txt");
 }
 
-bool put_flow(Flow &flow, int time, std::multiset<Port, ports_queue_cmp> &ports_queue,
-              std::multiset<Flow, wait_queue_cmp> &wait_queue,
-              std::ofstream &file) {
-    // 端口临时列表，暂存已经访问过的端口
-    std::vector<Port> temp_ports;
-    // 遍历端口，尝试找到能放得下本流的端口
-    while (!ports_queue.empty()) {
-        Port port = *ports_queue.begin();
-        ports_queue.erase(ports_queue.begin());
-        // 发出本流当：1.本流带宽小于该端口带宽容量 2.调度区已满且本流带宽小于该端口最大容量
-        if (flow.bandwidth <= port.bandwidth_capacity) {
-            // 更新flow的send_port
-            flow.send_port = port.id;
-            // 更新flow的send_time
-            flow.send_time = time;
-            // 写出安排结果
-            file << flow.id << "," << flow.send_port << "," << flow.send_time << std::endl;
-            // 更新port的带宽容量
-            port.bandwidth_capacity -= flow.bandwidth;
-            // 更新port的occupies
-            port.occupies.emplace_back(flow.occupied_time, flow.bandwidth);
-            // 将该端口放入临时队列中
-            temp_ports.emplace_back(port);
-            // 跳出循环
-            break;
-        } else if (flow.bandwidth <= port.max_bandwidth && wait_queue.size() >= MAX_POOL_SIZE) {
-            flow.send_port = port.id;
-            flow.send_time = time;
-            file << flow.id << "," << flow.send_port << "," << flow.send_time << std::endl;
-            // 若本port的排队区流数量小于30，send_port的排队区加入本流；否则，该流在该端口被抛弃
-            if (port.wait_queue.size() < 30)
-                port.wait_queue.push(flow);
-            // 将该端口放入临时队列中
-            temp_ports.emplace_back(port);
-            // 跳出循环
-            break;
-        } else {
-            // 将该端口放入临时队列中
-            temp_ports.emplace_back(port);
-            // 查看下一个当前带宽容量更大的端口能否放下
-            continue;
-        }
+// 打开数据集目录下的结果文件，失败时报错并返回空指针
+std::unique_ptr<BufferedFileSink> open_result_sink(const std::string &data_path, bool binary) {
+    std::string path = result_path(data_path, binary);
+    std::unique_ptr<BufferedFileSink> sink;
+    bool opened;
+    if (binary) {
+        auto binary_sink = new BinaryResultSink();
+        opened = binary_sink->open(path);
+        sink.reset(binary_sink);
+    } else {
+        auto text_sink = new TextResultSink();
+        opened = text_sink->open(path);
+        sink.reset(text_sink);
     }
-    // 将临时列表端口放回有序列表
-    for (auto &temp_port: temp_ports) {
-        ports_queue.insert(temp_port);
+    if (!opened) {
+        std::cerr << "can't open " << path << " for writing" << std::endl;
+        sink.reset();
     }
-    // 结束时，若flow的send_port仍为-1，说明没有找到能放得下本流的端口
-    if (flow.send_port == -1) {
+    return sink;
+}
+
+// 关闭结果文件，写出失败时报错并返回false
+bool close_result_sink(BufferedFileSink &sink, const std::string &data_path, bool binary) {
+    if (!sink.close()) {
+        std::cerr << "can't write " << result_path(data_path, binary) << std::endl;
         return false;
-    } else {
-        return true;
     }
+    return true;
 }
 
-// 看等待队列中的首SEE_NUM个流是否可以发出
-// 若首个流发出了，继续看等待队列中的首SEE_NUM个流是否可以发出
-void check_flows(std::multiset<Port, ports_queue_cmp> &ports_queue,
-                 std::multiset<Flow, wait_queue_cmp> &wait_queue,
-                 std::ofstream &file, int time, int see_num) {
-    // 发出流是否成功的标志
-    bool put_success;
-    int see_counter = see_num;
-    auto wait_flow_it = wait_queue.begin();
-    while (!wait_queue.empty() && wait_flow_it != wait_queue.end() && see_counter) {
-        Flow wait_flow = *wait_flow_it;
-        wait_flow_it = wait_queue.erase(wait_flow_it);
-        put_success = put_flow(wait_flow, time, ports_queue, wait_queue, file);
-        if (put_success) {
-            see_counter = see_num;
-        } else {
-            // 将本流放回等待队列，等待队列不变
-            wait_flow_it = ++wait_queue.insert(wait_flow);
-            see_counter--;
-        }
-    }
+// 失败的调度结果视为无穷大的时间
+long long config_cost(const Score &score) {
+    return score.ok() ? score.makespan : LLONG_MAX;
 }
 
-void solve(std::vector<Flow> &flows, std::vector<Port> &ports, const std::string &data_path) {
-    std::ofstream file(data_path + "/result.txt");
-    // 计算所有流的平均带宽
-    int total_bandwidth = 0;
-    for (auto &flow: flows) {
-        total_bandwidth += flow.bandwidth;
-    }
-    double average_bandwidth = (double) total_bandwidth / (int) flows.size();
-    // flows排序按照coming_time升序->occupied_time升序->bandwidth降序
-    std::sort(flows.begin(), flows.end(), [](const Flow &a, const Flow &b) {
-        if (a.coming_time == b.coming_time) {
-            if (a.occupied_time == b.occupied_time) {
-                return a.bandwidth > b.bandwidth;
-            } else {
-                return a.occupied_time < b.occupied_time;
+// 参数搜索：每个数据集在所有线程上并发运行grid中的每组参数，在进程内按阶段二规则评分，
+// 取时间最短的一组（相同时取grid中靠前的，保证不差于第0组）写出调度结果，并写出报告report_path
+// 自动调参与组合策略都用它，name用于输出
+int search_configs(const char *name, const std::vector<SolveConfig> &grid, const std::string &report_path,
+                   const std::vector<std::string> &data_paths, int threads, bool binary) {
+    int config_count = (int) grid.size();
+    int data_count = (int) data_paths.size();
+    auto start = std::chrono::steady_clock::now();
+    double cpu_start = process_cpu_seconds();
+    // 先读入全部数据集，各组参数共享只读的输入
+    std::vector<std::vector<Flow>> all_flows(data_count);
+    std::vector<std::vector<Port>> all_ports(data_count);
+    std::vector<std::vector<FlowInfo>> all_flow_infos(data_count);
+    std::vector<std::vector<PortInfo>> all_port_infos(data_count);
+    run_datasets(data_count, threads, [&](int data_num) {
+        read_files(data_paths[data_num], all_flows[data_num], all_ports[data_num]);
+        all_flow_infos[data_num] = flow_infos(all_flows[data_num]);
+        all_port_infos[data_num] = port_infos(all_ports[data_num]);
+    });
+    // 每个(数据集, 参数)组合是一个任务
+    std::vector<Score> scores((size_t) data_count * config_count);
+    std::vector<RunStats> stats = run_datasets(data_count * config_count, threads, [&](int task) {
+        int data_num = task / config_count;
+        std::vector<Flow> flows = all_flows[data_num];
+        std::vector<Port> ports = all_ports[data_num];
+        MemoryResultSink decisions;
+        solve(flows, ports, decisions, grid[task % config_count]);
+        scores[task] = score_stage2(all_flow_infos[data_num], all_port_infos[data_num], decisions.decisions);
+    });
+    // 选出每个数据集的最优参数并写出其调度结果
+    std::vector<int> best(data_count, 0);
+    for (int data_num = 0; data_num < data_count; data_num++) {
+        for (int c = 1; c < config_count; c++) {
+            if (config_cost(scores[data_num * config_count + c]) <
+                config_cost(scores[data_num * config_count + best[data_num]])) {
+                best[data_num] = c;
             }
-        } else {
-            return a.coming_time < b.coming_time;
         }
-    });
-    // ports排序按照ports_queue_cmp规则
-    std::multiset<Port, ports_queue_cmp> ports_queue;
-    for (auto &port: ports) {
-        ports_queue.insert(port);
     }
-    // 调度区的流，按照wait_queue_cmp规则排序
-    // 该队列的大小即为当前调度区中流的数量
-    std::multiset<Flow, wait_queue_cmp> wait_queue;
-    // 计时器
-    int time = 0;
-    // 调度区最大容量
-    MAX_POOL_SIZE = int(ports_queue.size()) * 20;
-    // 带宽是否发生变化的标志，作为剪枝，避免无意义地尝试发出流
-    bool bandwidth_changed;
-    for (auto &flow: flows) {
-        wait_queue.insert(flow);
-        // 当前流的到达时间大于程序中存储的时间，更新时间
-        if (flow.coming_time > time) {
-            for (int i = 0; i < flow.coming_time - time; i++) {
-                update_ports(ports_queue, bandwidth_changed);
-            }
-            // 状态更新完毕，更新时间
-            time = flow.coming_time;
+    std::vector<char> failed(data_count);
+    run_datasets(data_count, threads, [&](int data_num) {
+        const std::string &data_path = data_paths[data_num];
+        std::unique_ptr<BufferedFileSink> sink = open_result_sink(data_path, binary);
+        if (!sink) {
+            failed[data_num] = 1;
+            return;
         }
-        // 遍历ports_queue，找到所有排队区满的端口，将其放入throw_port_id_list中
-        std::vector<int> throw_port_id_list;
-        for (auto &port: ports_queue) {
-            if (port.wait_queue.size() >= 30) {
-                throw_port_id_list.push_back(port.id);
-            }
+        solve(all_flows[data_num], all_ports[data_num], *sink, grid[best[data_num]]);
+        if (!close_result_sink(*sink, data_path, binary)) {
+            failed[data_num] = 1;
         }
-        // 若调度区已满，且有排队区满以及最大带宽大于流宽的端口，把等待队列中首流拿出来在此端口抛弃
-        if (wait_queue.size() >= MAX_POOL_SIZE && !throw_port_id_list.empty() &&
-            wait_queue.begin()->bandwidth > average_bandwidth) {
-            Flow wait_flow = *wait_queue.begin();
-            wait_queue.erase(wait_queue.begin());
-            for (auto port_id: throw_port_id_list) {
-                auto port = std::find_if(ports_queue.begin(), ports_queue.end(), [port_id](const Port &port) {
-                    return port.id == port_id;
-                });
-                if (port->max_bandwidth >= wait_flow.bandwidth) {
-                    wait_flow.send_port = port_id;
-                    wait_flow.send_time = time;
-                    file << wait_flow.id << "," << wait_flow.send_port << "," << wait_flow.send_time << std::endl;
-                    break;
-                }
-            }
-            // 到此，若找不到能抛弃的端口，将其放回队列
-            if (wait_flow.send_port == -1) {
-                wait_queue.insert(wait_flow);
-            }
+    });
+    double total_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    // 报告：每个数据集的默认参数成绩、最优参数成绩与最优参数
+    std::ofstream report(report_path);
+    report << "data,default_time,best_time,pool_factor,see_num_changed,see_num_unchanged,discard_ratio,"
+              "port_queue_cap,flow_order,fill_freed_ports,placement,batch_admission,solve_cpu_time" << std::endl;
+    double cpu_time = process_cpu_seconds() - cpu_start;
+    for (int data_num = 0; data_num < data_count; data_num++) {
+        const Score &default_score = scores[data_num * config_count];
+        const Score &best_score = scores[data_num * config_count + best[data_num]];
+        double data_cpu_time = 0;
+        for (int c = 0; c < config_count; c++) {
+            data_cpu_time += stats[data_num * config_count + c].cpu_time;
         }
-        if (bandwidth_changed) {
-            check_flows(ports_queue, wait_queue, file, time, 5);
+        std::cout << "data " << data_num << ": ";
+        if (default_score.ok()) {
+            std::cout << "default " << default_score.makespan;
         } else {
-            check_flows(ports_queue, wait_queue, file, time, 1);
+            std::cout << "default failed (" << score_error_name(default_score.error) << ")";
         }
-    }
-    // 读取flow结束，等待时间中的各流可视为同时到达，此时wait_queue只有出没有入，不可能爆调度区
-    while (!wait_queue.empty()) {
-        // 更新时间
-        time++;
-        bandwidth_changed = false;
-        update_ports(ports_queue, bandwidth_changed);
-        if (bandwidth_changed) {
-            check_flows(ports_queue, wait_queue, file, time, 5);
+        if (best_score.ok()) {
+            std::cout << ", best " << best_score.makespan << " with " << config_fields(grid[best[data_num]]);
+        } else {
+            std::cout << ", no valid config";
         }
+        std::cout << " (cpu " << data_cpu_time << "s)" << std::endl;
+        report << data_num << ',' << config_cost(default_score) << ',' << config_cost(best_score) << ','
+               << config_fields(grid[best[data_num]]) << ',' << data_cpu_time << std::endl;
+    }
+    std::cout << name << ": " << config_count << " configs per dataset, total time " << total_time << "s (cpu "
+              << cpu_time << "s, " << threads << " threads)" << std::endl;
+    return std::count(failed.begin(), failed.end(), 1) > 0 ? 1 : 0;
+}
+
+// 启用了调度器统计时，把一个数据集的统计写到其目录下的solve_stats.json
+void write_solve_stats(const std::string &data_path, const SolveStats &counters) {
+    if (SOLVE_STATS_ENABLED) {
+        std::ofstream out(data_path + "/solve_stats.json");
+        counters.write_json(out);
     }
-    file.close();
 }
 
 // 输出文件result不加第一行描述，不用排序，放在和输入文件同目录
-int main() {
-    int data_num = 0;
-    int sum_time = 0;
-    // 遍历../data文件夹下的输入文件夹
+// 用法：main [data_root] [-j 线程数] [--binary] [--score] [--improve 秒数] [--autotune | --portfolio] [--stream [--window N]]
+// 默认处理../data下的各数据集，线程数默认为机器的硬件线程数；--binary时输出二进制的result.bin
+// --score时在进程内按阶段二规则为调度结果评分，不必再运行评测程序
+// --improve时对每个数据集的调度结果在给定的墙上时间内做局部搜索，写出改进后的结果，并输出改进前后的阶段二总用时
+// --autotune时为每个数据集搜索调度参数，写出最优参数的调度结果与autotune_report.csv
+// --portfolio时每个数据集并发运行最佳适配、最差适配、最早结束端口、大带宽优先、同时到达批量装箱五种策略，写出最优策略的调度结果与portfolio_report.csv
+// 以-DZTE_SOLVE_STATS编译时，每个数据集另写出solve_stats.json：调度器内部的计数、峰值与各阶段时间
+// --stream时边读边调度，flow.txt需按到达时间排序或只在N行（默认65536）的窗口内乱序，不支持--score、--improve、--autotune与--portfolio
+int main(int argc, char *argv[]) {
     std::string data_root = "../data";
-    while (true) {
-        std::string data_path = data_root + "/" + std::to_string(data_num);
-        // 判断文件夹是否存在
-        struct stat s{};
-        if (stat(data_path.c_str(), &s) == 0 && (s.st_mode & S_IFDIR)) {
-            // 计时开始
-            clock_t start, end;
-            start = clock();
-            // data_num号样本目录存在，处理数据
-            std::vector<Flow> flows;
-            std::vector<Port> ports;
-            read_files(data_path, flows, ports);
-            // 流调度
-            solve(flows, ports, data_path);
-            // 计时结束
-            end = clock();
-            std::cout << "data " << data_num << " done in " << (double) (end - start) / CLOCKS_PER_SEC << "s"
-                      << std::endl;
-            // 计算总时间
-            sum_time += (end - start);
-            data_num++;
+    int threads = default_threads();
+    bool binary = false;
+    bool score = false;
+    bool tune = false;
+    bool portfolio = false;
+    bool stream = false;
+    double improve = 0;
+    size_t window = 1 << 16;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) {
+            threads = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--binary") {
+            binary = true;
+        } else if (arg == "--score") {
+            score = true;
+        } else if (arg == "--improve" && i + 1 < argc) {
+            improve = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--autotune") {
+            tune = true;
+        } else if (arg == "--portfolio") {
+            portfolio = true;
+        } else if (arg == "--stream") {
+            stream = true;
+        } else if (arg == "--window" && i + 1 < argc) {
+            window = (size_t) std::max(1, std::atoi(argv[++i]));
+        } else {
+            data_root = arg;
+        }
+    }
+    // 遍历data_root文件夹下的输入文件夹
+    std::vector<std::string> data_paths = list_datasets(data_root);
+    if (stream && (tune || portfolio || score || improve > 0)) {
+        std::cerr << "--stream can't be combined with --score, --improve, --autotune or --portfolio" << std::endl;
+        return 1;
+    }
+    if (tune) {
+        return search_configs("autotune", autotune_grid(), data_root + "/autotune_report.csv", data_paths, threads,
+                              binary);
+    }
+    if (portfolio) {
+        return search_configs("portfolio", portfolio_grid(), data_root + "/portfolio_report.csv", data_paths,
+                              threads, binary);
+    }
+    std::vector<size_t> flow_counts(data_paths.size());
+    std::vector<long long> late_flows(data_paths.size());
+    std::vector<Score> scores(data_paths.size());
+    std::vector<int> improved_times(data_paths.size(), -1);
+    std::vector<long long> tried_moves(data_paths.size());
+    std::vector<long long> accepted_moves(data_paths.size());
+    auto start = std::chrono::steady_clock::now();
+    double cpu_start = process_cpu_seconds();
+    std::vector<char> failed(data_paths.size());
+    std::vector<RunStats> stats = run_datasets((int) data_paths.size(), threads, [&](int data_num) {
+        const std::string &data_path = data_paths[data_num];
+        std::unique_ptr<BufferedFileSink> sink = open_result_sink(data_path, binary);
+        if (!sink) {
+            failed[data_num] = 1;
+            return;
+        }
+        // 以-DZTE_SOLVE_STATS编译时，统计调度器内部的计数与各阶段时间，写出solve_stats.json
+        SolveStats counters;
+        StatsScope stats_scope(counters);
+        if (stream) {
+            FlowStream flow_stream;
+            solve_stream(data_path, window, *sink, flow_stream);
+            flow_counts[data_num] = flow_stream.flows;
+            late_flows[data_num] = flow_stream.late_flows;
+            write_solve_stats(data_path, counters);
+            if (!close_result_sink(*sink, data_path, binary)) {
+                failed[data_num] = 1;
+            }
+            return;
+        }
+        std::vector<Flow> flows;
+        std::vector<Port> ports;
+        read_files(data_path, flows, ports);
+        flow_counts[data_num] = flows.size();
+        // 流调度
+        if (score || improve > 0) {
+            // 先在内存中调度并评分，需要时做局部搜索，再写出
+            std::vector<FlowInfo> flow_info = flow_infos(flows);
+            std::vector<PortInfo> port_info = port_infos(ports);
+            MemoryResultSink decisions;
+            solve(flows, ports, decisions);
+            scores[data_num] = score_stage2(flow_info, port_info, decisions.decisions);
+            if (improve > 0) {
+                LocalSearch search(flow_info, port_info);
+                improved_times[data_num] = search.run(decisions.decisions, improve);
+                tried_moves[data_num] = search.tried_moves;
+                accepted_moves[data_num] = search.accepted_moves;
+            }
+            for (auto &decision: decisions.decisions) {
+                sink->put(decision.flow_id, decision.port_id, decision.send_time);
+            }
+            sink->flush();
         } else {
-            // 终止遍历
-            break;
+            solve(flows, ports, *sink);
+        }
+        write_solve_stats(data_path, counters);
+        if (!close_result_sink(*sink, data_path, binary)) {
+            failed[data_num] = 1;
         }
+    });
+    double total_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    // 按数据集编号输出各自的墙上时间、CPU时间与峰值内存
+    double cpu_time = process_cpu_seconds() - cpu_start;
+    size_t total_flows = 0;
+    for (int data_num = 0; data_num < (int) data_paths.size(); data_num++) {
+        if (failed[data_num]) {
+            std::cout << "data " << data_num << " failed: can't write the result file" << std::endl;
+            continue;
+        }
+        std::cout << "data " << data_num << " done in " << stats[data_num].wall_time << "s (cpu "
+                  << stats[data_num].cpu_time << "s, peak " << stats[data_num].peak_memory_kb << "KB)";
+        if (score || improve > 0) {
+            if (scores[data_num].ok()) {
+                std::cout << ", stage2 time " << scores[data_num].makespan;
+            } else {
+                std::cout << ", stage2 failed: " << score_error_name(scores[data_num].error);
+            }
+        }
+        if (improved_times[data_num] >= 0) {
+            std::cout << ", improved to " << improved_times[data_num] << " (" << accepted_moves[data_num] << '/'
+                      << tried_moves[data_num] << " moves accepted)";
+        }
+        if (late_flows[data_num] > 0) {
+            std::cout << ", " << late_flows[data_num] << " flows arrived outside the reorder window";
+        }
+        std::cout << std::endl;
+        total_flows += flow_counts[data_num];
     }
-    std::cout << "total time: " << (double) sum_time / CLOCKS_PER_SEC << "s" << std::endl;
-    return 0;
+    std::cout << "total time: " << total_time << "s (cpu " << cpu_time << "s, " << threads << " threads)" << std::endl;
+    if (total_time > 0) {
+        std::cout << "throughput: " << data_paths.size() / total_time << " datasets/s, "
+                  << total_flows / total_time << " flows/s" << std::endl;
+    }
+    return std::count(failed.begin(), failed.end(), 1) > 0 ? 1 : 0;
 }
-
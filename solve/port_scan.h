@@ -0,0 +1,367 @@
+#ifndef ZTE_SOLVE_PORT_SCAN_H
+#define ZTE_SOLVE_PORT_SCAN_H
+
+// 按列存放的端口表与向量化的扫描查询：端口数不多时，顺序扫描连续的int32列比有序集合与线段树更快
+// 查询内核有标量、AVX2、AVX-512三种实现，运行时按CPU支持的指令集选择，非x86或非GCC/Clang编译器只用标量实现
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define ZTE_PORT_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+// 按64字节对齐分配，向量加载不跨缓存行
+template<typename T>
+class AlignedAllocator {
+public:
+    using value_type = T;
+    static const size_t ALIGNMENT = 64;
+
+    AlignedAllocator() = default;
+
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U> &) {}
+
+    T *allocate(size_t n) {
+        size_t bytes = (n * sizeof(T) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        void *p = std::aligned_alloc(ALIGNMENT, std::max(bytes, ALIGNMENT));
+        if (p == nullptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T *>(p);
+    }
+
+    void deallocate(T *p, size_t) {
+        std::free(p);
+    }
+
+    template<typename U>
+    bool operator==(const AlignedAllocator<U> &) const {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const AlignedAllocator<U> &) const {
+        return false;
+    }
+};
+
+using AlignedColumn = std::vector<int32_t, AlignedAllocator<int32_t>>;
+
+// 查询内核，n为补齐后的长度（16的倍数），value相同时比较tie
+// min_where：满足key[i] >= bound且key2[i] >= bound2的i中(value[i], tie[i])最小的一个，再相同时取下标小的，不存在时返回-1
+// max_at：(value[i], tie[i])最大的i，再相同时取下标大的，n为0时返回-1
+// port_limit为扫描快于有序集合的端口数上限，取自bench --scan的实测（含容量更新），超过时端口池改用有序索引
+class ScanKernels {
+public:
+    const char *name;
+    int port_limit;
+    int (*min_where)(const int32_t *value, const int32_t *tie, const int32_t *key, int32_t bound, const int32_t *key2,
+                     int32_t bound2, int n);
+    int (*max_at)(const int32_t *value, const int32_t *tie, int n);
+};
+
+inline int scan_min_where_scalar(const int32_t *value, const int32_t *tie, const int32_t *key, int32_t bound,
+                                 const int32_t *key2, int32_t bound2, int n) {
+    int best = -1;
+    int32_t best_value = INT32_MAX;
+    int32_t best_tie = INT32_MAX;
+    for (int i = 0; i < n; i++) {
+        if (key[i] >= bound && key2[i] >= bound2
+            && (value[i] < best_value || (value[i] == best_value && tie[i] < best_tie))) {
+            best = i;
+            best_value = value[i];
+            best_tie = tie[i];
+        }
+    }
+    return best;
+}
+
+inline int scan_max_at_scalar(const int32_t *value, const int32_t *tie, int n) {
+    int best = -1;
+    int32_t best_value = INT32_MIN;
+    int32_t best_tie = INT32_MIN;
+    for (int i = 0; i < n; i++) {
+        if (value[i] > best_value || (value[i] == best_value && tie[i] >= best_tie)) {
+            best = i;
+            best_value = value[i];
+            best_tie = tie[i];
+        }
+    }
+    return best;
+}
+
+// 各通道各自保留的(最小值, tie, 下标)合并为一个
+inline int scan_reduce_min(const int32_t *values, const int32_t *ties, const int32_t *indexes, int lanes) {
+    int best = -1;
+    for (int lane = 0; lane < lanes; lane++) {
+        if (indexes[lane] >= 0 && (best < 0 || values[lane] < values[best]
+                                   || (values[lane] == values[best] && (ties[lane] < ties[best]
+                                       || (ties[lane] == ties[best] && indexes[lane] < indexes[best]))))) {
+            best = lane;
+        }
+    }
+    return best < 0 ? -1 : indexes[best];
+}
+
+// 各通道各自保留的(最大值, tie, 下标)合并为一个
+inline int scan_reduce_max(const int32_t *values, const int32_t *ties, const int32_t *indexes, int lanes) {
+    int best = -1;
+    for (int lane = 0; lane < lanes; lane++) {
+        if (indexes[lane] >= 0 && (best < 0 || values[lane] > values[best]
+                                   || (values[lane] == values[best] && (ties[lane] > ties[best]
+                                       || (ties[lane] == ties[best] && indexes[lane] > indexes[best]))))) {
+            best = lane;
+        }
+    }
+    return best < 0 ? -1 : indexes[best];
+}
+
+#ifdef ZTE_PORT_SCAN_X86
+
+__attribute__((target("avx2")))
+inline int scan_min_where_avx2(const int32_t *value, const int32_t *tie, const int32_t *key, int32_t bound,
+                               const int32_t *key2, int32_t bound2, int n) {
+    // key >= bound即key > bound - 1，bound为INT32_MIN时条件恒成立
+    const __m256i below = _mm256_set1_epi32(bound == INT32_MIN ? INT32_MIN : bound - 1);
+    const __m256i below2 = _mm256_set1_epi32(bound2 == INT32_MIN ? INT32_MIN : bound2 - 1);
+    const __m256i all = _mm256_set1_epi32(-1);
+    const __m256i step = _mm256_set1_epi32(8);
+    __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i best = _mm256_set1_epi32(INT32_MAX);
+    __m256i best_tie = _mm256_set1_epi32(INT32_MAX);
+    __m256i best_index = _mm256_set1_epi32(-1);
+    for (int i = 0; i < n; i += 8) {
+        __m256i v = _mm256_load_si256((const __m256i *) (value + i));
+        __m256i t = _mm256_load_si256((const __m256i *) (tie + i));
+        __m256i ok = bound == INT32_MIN ? all
+                                        : _mm256_cmpgt_epi32(_mm256_load_si256((const __m256i *) (key + i)), below);
+        if (bound2 != INT32_MIN) {
+            ok = _mm256_and_si256(ok, _mm256_cmpgt_epi32(_mm256_load_si256((const __m256i *) (key2 + i)), below2));
+        }
+        // v < best，或v == best且t < best_tie
+        __m256i less = _mm256_or_si256(_mm256_cmpgt_epi32(best, v),
+                                       _mm256_and_si256(_mm256_cmpeq_epi32(v, best), _mm256_cmpgt_epi32(best_tie, t)));
+        __m256i better = _mm256_and_si256(ok, less);
+        best = _mm256_blendv_epi8(best, v, better);
+        best_tie = _mm256_blendv_epi8(best_tie, t, better);
+        best_index = _mm256_blendv_epi8(best_index, index, better);
+        index = _mm256_add_epi32(index, step);
+    }
+    alignas(32) int32_t values[8];
+    alignas(32) int32_t ties[8];
+    alignas(32) int32_t indexes[8];
+    _mm256_store_si256((__m256i *) values, best);
+    _mm256_store_si256((__m256i *) ties, best_tie);
+    _mm256_store_si256((__m256i *) indexes, best_index);
+    return scan_reduce_min(values, ties, indexes, 8);
+}
+
+__attribute__((target("avx2")))
+inline int scan_max_at_avx2(const int32_t *value, const int32_t *tie, int n) {
+    const __m256i step = _mm256_set1_epi32(8);
+    __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i best = _mm256_set1_epi32(INT32_MIN);
+    __m256i best_tie = _mm256_set1_epi32(INT32_MIN);
+    __m256i best_index = _mm256_set1_epi32(-1);
+    for (int i = 0; i < n; i += 8) {
+        __m256i v = _mm256_load_si256((const __m256i *) (value + i));
+        __m256i t = _mm256_load_si256((const __m256i *) (tie + i));
+        // v > best，或v == best且t >= best_tie，下标大的覆盖下标小的
+        __m256i not_less = _mm256_or_si256(_mm256_cmpgt_epi32(t, best_tie), _mm256_cmpeq_epi32(t, best_tie));
+        __m256i better = _mm256_or_si256(_mm256_cmpgt_epi32(v, best),
+                                         _mm256_and_si256(_mm256_cmpeq_epi32(v, best), not_less));
+        best = _mm256_blendv_epi8(best, v, better);
+        best_tie = _mm256_blendv_epi8(best_tie, t, better);
+        best_index = _mm256_blendv_epi8(best_index, index, better);
+        index = _mm256_add_epi32(index, step);
+    }
+    alignas(32) int32_t values[8];
+    alignas(32) int32_t ties[8];
+    alignas(32) int32_t indexes[8];
+    _mm256_store_si256((__m256i *) values, best);
+    _mm256_store_si256((__m256i *) ties, best_tie);
+    _mm256_store_si256((__m256i *) indexes, best_index);
+    return scan_reduce_max(values, ties, indexes, 8);
+}
+
+__attribute__((target("avx512f")))
+inline int scan_min_where_avx512(const int32_t *value, const int32_t *tie, const int32_t *key, int32_t bound,
+                                 const int32_t *key2, int32_t bound2, int n) {
+    const __m512i bounds = _mm512_set1_epi32(bound);
+    const __m512i bounds2 = _mm512_set1_epi32(bound2);
+    const __m512i step = _mm512_set1_epi32(16);
+    __m512i index = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    __m512i best = _mm512_set1_epi32(INT32_MAX);
+    __m512i best_tie = _mm512_set1_epi32(INT32_MAX);
+    __m512i best_index = _mm512_set1_epi32(-1);
+    for (int i = 0; i < n; i += 16) {
+        __m512i v = _mm512_load_si512((const void *) (value + i));
+        __m512i t = _mm512_load_si512((const void *) (tie + i));
+        __mmask16 ok = _mm512_cmpge_epi32_mask(_mm512_load_si512((const void *) (key + i)), bounds);
+        ok &= _mm512_cmpge_epi32_mask(_mm512_load_si512((const void *) (key2 + i)), bounds2);
+        __mmask16 better = _mm512_mask_cmplt_epi32_mask(ok, v, best)
+                           | (_mm512_mask_cmpeq_epi32_mask(ok, v, best) & _mm512_cmplt_epi32_mask(t, best_tie));
+        best = _mm512_mask_mov_epi32(best, better, v);
+        best_tie = _mm512_mask_mov_epi32(best_tie, better, t);
+        best_index = _mm512_mask_mov_epi32(best_index, better, index);
+        index = _mm512_add_epi32(index, step);
+    }
+    alignas(64) int32_t values[16];
+    alignas(64) int32_t ties[16];
+    alignas(64) int32_t indexes[16];
+    _mm512_store_si512((void *) values, best);
+    _mm512_store_si512((void *) ties, best_tie);
+    _mm512_store_si512((void *) indexes, best_index);
+    return scan_reduce_min(values, ties, indexes, 16);
+}
+
+__attribute__((target("avx512f")))
+inline int scan_max_at_avx512(const int32_t *value, const int32_t *tie, int n) {
+    const __m512i step = _mm512_set1_epi32(16);
+    __m512i index = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    __m512i best = _mm512_set1_epi32(INT32_MIN);
+    __m512i best_tie = _mm512_set1_epi32(INT32_MIN);
+    __m512i best_index = _mm512_set1_epi32(-1);
+    for (int i = 0; i < n; i += 16) {
+        __m512i v = _mm512_load_si512((const void *) (value + i));
+        __m512i t = _mm512_load_si512((const void *) (tie + i));
+        __mmask16 better = _mm512_cmpgt_epi32_mask(v, best)
+                           | (_mm512_cmpeq_epi32_mask(v, best) & _mm512_cmpge_epi32_mask(t, best_tie));
+        best = _mm512_mask_mov_epi32(best, better, v);
+        best_tie = _mm512_mask_mov_epi32(best_tie, better, t);
+        best_index = _mm512_mask_mov_epi32(best_index, better, index);
+        index = _mm512_add_epi32(index, step);
+    }
+    alignas(64) int32_t values[16];
+    alignas(64) int32_t ties[16];
+    alignas(64) int32_t indexes[16];
+    _mm512_store_si512((void *) values, best);
+    _mm512_store_si512((void *) ties, best_tie);
+    _mm512_store_si512((void *) indexes, best_index);
+    return scan_reduce_max(values, ties, indexes, 16);
+}
+
+#endif
+
+// 指令集
+enum class ScanIsa {
+    SCALAR,
+    AVX2,
+    AVX512,
+};
+
+// 指定指令集的内核，CPU不支持时退回标量实现
+inline const ScanKernels &scan_kernels(ScanIsa isa) {
+    static const ScanKernels scalar{"scalar", 64, scan_min_where_scalar, scan_max_at_scalar};
+#ifdef ZTE_PORT_SCAN_X86
+    static const ScanKernels avx2{"avx2", 256, scan_min_where_avx2, scan_max_at_avx2};
+    static const ScanKernels avx512{"avx512", 512, scan_min_where_avx512, scan_max_at_avx512};
+    if (isa == ScanIsa::AVX512 && __builtin_cpu_supports("avx512f")) {
+        return avx512;
+    }
+    if (isa != ScanIsa::SCALAR && __builtin_cpu_supports("avx2")) {
+        return avx2;
+    }
+#else
+    (void) isa;
+#endif
+    return scalar;
+}
+
+// CPU支持的最快的内核，只检测一次
+inline const ScanKernels &best_scan_kernels() {
+    static const ScanKernels &kernels = scan_kernels(ScanIsa::AVX512);
+    return kernels;
+}
+
+// 端口表：带宽容量、最大带宽、排队区长度、排队区是否为空、同带宽容量时的先后次序五列，按64字节对齐，长度补齐到16的倍数
+// 补齐的位置各列都是INT32_MIN，不满足任何查询条件
+class PortTable {
+public:
+    AlignedColumn capacity;
+    AlignedColumn max_bandwidth;
+    AlignedColumn queue_length;
+    // 排队区为空时为1，否则为0
+    AlignedColumn idle;
+    AlignedColumn order;
+
+public:
+    explicit PortTable(const ScanKernels &kernels = best_scan_kernels()) : kernels(&kernels) {}
+
+    int size() const {
+        return count;
+    }
+
+    // 所用内核适合扫描的端口数上限
+    int port_limit() const {
+        return kernels->port_limit;
+    }
+
+    void add(int32_t port_capacity, int32_t port_max_bandwidth, int32_t port_queue_length, int32_t port_order) {
+        if (count == (int) capacity.size()) {
+            size_t padded = capacity.size() + 16;
+            capacity.resize(padded, INT32_MIN);
+            max_bandwidth.resize(padded, INT32_MIN);
+            queue_length.resize(padded, INT32_MIN);
+            idle.resize(padded, INT32_MIN);
+            order.resize(padded, INT32_MIN);
+        }
+        capacity[count] = port_capacity;
+        max_bandwidth[count] = port_max_bandwidth;
+        queue_length[count] = port_queue_length;
+        idle[count] = port_queue_length == 0;
+        order[count] = port_order;
+        count++;
+    }
+
+    // 带宽容量不小于bandwidth的端口中(带宽容量, 次序)最小的一个
+    int best_fit(int32_t bandwidth) const {
+        return kernels->min_where(capacity.data(), order.data(), capacity.data(), bandwidth, capacity.data(),
+                                  INT32_MIN, (int) capacity.size());
+    }
+
+    // 排队区为空、且带宽容量不小于bandwidth的端口中(带宽容量, 次序)最小的一个
+    int idle_best_fit(int32_t bandwidth) const {
+        return kernels->min_where(capacity.data(), order.data(), capacity.data(), bandwidth, idle.data(), 1,
+                                  (int) capacity.size());
+    }
+
+    // (带宽容量, 次序)最大的端口
+    int widest() const {
+        return count == 0 ? -1 : kernels->max_at(capacity.data(), order.data(), (int) capacity.size());
+    }
+
+    // 排队区为空的端口中最大的带宽容量，没有这样的端口时返回-1
+    int32_t idle_max_capacity() const {
+        int32_t best = -1;
+        for (int i = 0; i < count; i++) {
+            best = std::max(best, idle[i] > 0 ? capacity[i] : -1);
+        }
+        return best;
+    }
+
+    // 最大带宽不小于bandwidth的端口中(带宽容量, 次序)最小的一个
+    int first_max_fit(int32_t bandwidth) const {
+        return kernels->min_where(capacity.data(), order.data(), max_bandwidth.data(), bandwidth,
+                                  max_bandwidth.data(), bandwidth, (int) capacity.size());
+    }
+
+    // 排队区长度不小于queue_cap、且最大带宽不小于bandwidth的端口中(带宽容量, 次序)最小的一个
+    int full_queue_fit(int32_t bandwidth, int32_t queue_cap) const {
+        return kernels->min_where(capacity.data(), order.data(), max_bandwidth.data(), bandwidth,
+                                  queue_length.data(), queue_cap, (int) capacity.size());
+    }
+
+private:
+    const ScanKernels *kernels;
+    int count = 0;
+};
+
+#endif //ZTE_SOLVE_PORT_SCAN_H
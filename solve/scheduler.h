@@ -0,0 +1,211 @@
+#ifndef ZTE_SOLVE_SCHEDULER_H
+#define ZTE_SOLVE_SCHEDULER_H
+
+// 在线调度器：端口随时加入，流随到随调度，不需要事先拿到全部的流；调度策略与solve()相同
+// 每次调用只做与其间发生的端口事件及产生的决策成正比的工作，端口选择与调度区查询都是O(logP)或O(logB)
+// （端口不多时改为在端口表上向量化扫描），只有Placement::EARLIEST_FINISH需要逐个查看端口；每次调用的耗时记入直方图，可以检查是否跟得上线速
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <vector>
+#include "solver.h"
+
+// 单次调用耗时（纳秒）的直方图：按2的幂分档，每档再等分为8格，相对误差不超过12.5%，记录一次为O(1)
+class LatencyHistogram {
+public:
+    void record(long long nanoseconds) {
+        nanoseconds = std::max(0LL, nanoseconds);
+        counts[bucket(nanoseconds)]++;
+        total++;
+        maximum = std::max(maximum, nanoseconds);
+    }
+
+    long long count() const {
+        return total;
+    }
+
+    // 分位数q（0~1）所在格的上界，没有记录时返回0
+    long long percentile(double q) const {
+        long long rank = (long long) (q * (double) total);
+        long long seen = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            seen += counts[i];
+            if (seen > rank) {
+                return std::min(upper(i), maximum);
+            }
+        }
+        return maximum;
+    }
+
+    long long max() const {
+        return maximum;
+    }
+
+private:
+    // 0~15各占一格，此后每个2的幂8格
+    static const int BUCKETS = 16 + 60 * 8;
+    long long counts[BUCKETS] = {};
+    long long total = 0;
+    long long maximum = 0;
+
+    static int bucket(long long value) {
+        if (value < 16) {
+            return (int) value;
+        }
+        int exponent = 63 - __builtin_clzll((unsigned long long) value);
+        return 16 + (exponent - 4) * 8 + (int) ((value >> (exponent - 3)) & 7);
+    }
+
+    static long long upper(int bucket) {
+        if (bucket < 16) {
+            return bucket;
+        }
+        int exponent = (bucket - 16) / 8 + 4;
+        long long sub = (bucket - 16) % 8;
+        return ((8 + sub + 1) << (exponent - 3)) - 1;
+    }
+};
+
+class Scheduler {
+public:
+    // 一个流到达后的去向
+    class Admission {
+    public:
+        enum Kind {
+            // 已发往端口port_id（可能在其排队区中等待）
+            SENT,
+            // 进入调度区等待，以后由advance给出
+            DEFERRED,
+            // 被抛弃到端口port_id
+            DISCARDED,
+        };
+        Kind kind;
+        int port_id;
+    };
+
+    // advance给出的决策：上一次advance以来新发出的流与被抛弃的流，不含on_arrival已直接返回的到达流本身
+    class Issued {
+    public:
+        std::vector<Decision> sent;
+        std::vector<Decision> discarded;
+    };
+
+    // on_arrival与advance每次调用的耗时
+    LatencyHistogram arrival_latency;
+    LatencyHistogram advance_latency;
+
+public:
+    // average_bandwidth为流的平均带宽，调度区满时据此决定是否抛弃；不大于0时用已到达的流的平均带宽
+    explicit Scheduler(const SolveConfig &config = SolveConfig(), double average_bandwidth = 0)
+            : state(std::vector<Port>(), average_bandwidth, config) {
+        this->fixed_average = average_bandwidth > 0;
+    }
+
+    void add_port(int id, int bandwidth) {
+        state.add_port(Port(id, bandwidth));
+    }
+
+    // 流在now时刻到达，now不应早于之前的调用；先把端口更新到now再调度
+    Admission on_arrival(const Flow &flow, int now) {
+        auto start = std::chrono::steady_clock::now();
+        if (!fixed_average) {
+            total_bandwidth += flow.bandwidth;
+            arrivals++;
+            state.set_average_bandwidth((double) total_bandwidth / (double) arrivals);
+        }
+        Flow arrived = flow;
+        arrived.coming_time = now;
+        size_t sent_before = capture.issued.sent.size();
+        size_t discarded_before = capture.issued.discarded.size();
+        state.arrive(arrived, capture);
+        Admission admission{Admission::DEFERRED, -1};
+        // 到达流本身的决策直接返回，记下其位置，advance时从待给出的决策中去掉
+        if (take(capture.issued.sent, sent_before, flow.id, admission.port_id, taken_sent)) {
+            admission.kind = Admission::SENT;
+        } else if (take(capture.issued.discarded, discarded_before, flow.id, admission.port_id, taken_discarded)) {
+            admission.kind = Admission::DISCARDED;
+        }
+        arrival_latency.record(elapsed_nanoseconds(start));
+        return admission;
+    }
+
+    // 把端口与调度区推进到now，返回上一次advance以来的决策，结果在下一次调用advance前有效
+    const Issued &advance(int now) {
+        auto start = std::chrono::steady_clock::now();
+        state.advance(now, capture);
+        collect(capture.issued.sent, taken_sent, issued.sent);
+        collect(capture.issued.discarded, taken_discarded, issued.discarded);
+        advance_latency.record(elapsed_nanoseconds(start));
+        return issued;
+    }
+
+    // 调度器的内部状态，可用于查询调度区与端口
+    const ScheduleState &schedule_state() const {
+        return state;
+    }
+
+private:
+    // 把决策分成发出与抛弃两类缓存起来
+    class CaptureSink : public ResultSink {
+    public:
+        Issued issued;
+
+    public:
+        void put(int flow_id, int port_id, int send_time) override {
+            issued.sent.emplace_back(flow_id, port_id, send_time);
+        }
+
+        void discard(int flow_id, int port_id, int send_time) override {
+            issued.discarded.emplace_back(flow_id, port_id, send_time);
+        }
+    };
+
+    ScheduleState state;
+    CaptureSink capture;
+    Issued issued;
+    bool fixed_average;
+    long long total_bandwidth = 0;
+    long long arrivals = 0;
+    // 已由on_arrival直接返回的决策在capture中的位置，升序
+    std::vector<size_t> taken_sent;
+    std::vector<size_t> taken_discarded;
+
+    // 在decisions的from之后找流flow_id的决策，找到则把位置记入taken并记下端口
+    static bool take(const std::vector<Decision> &decisions, size_t from, int flow_id, int &port_id,
+                     std::vector<size_t> &taken) {
+        for (size_t i = from; i < decisions.size(); i++) {
+            if (decisions[i].flow_id == flow_id) {
+                port_id = decisions[i].port_id;
+                taken.push_back(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // decisions中除taken位置以外的决策按原顺序移入out，之后清空decisions与taken
+    static void collect(std::vector<Decision> &decisions, std::vector<size_t> &taken, std::vector<Decision> &out) {
+        out.clear();
+        if (taken.empty()) {
+            out.swap(decisions);
+            return;
+        }
+        size_t next = 0;
+        for (size_t i = 0; i < decisions.size(); i++) {
+            if (next < taken.size() && taken[next] == i) {
+                next++;
+            } else {
+                out.push_back(decisions[i]);
+            }
+        }
+        decisions.clear();
+        taken.clear();
+    }
+
+    static long long elapsed_nanoseconds(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+#endif //ZTE_SOLVE_SCHEDULER_H
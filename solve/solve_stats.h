@@ -0,0 +1,133 @@
+#ifndef ZTE_SOLVE_SOLVE_STATS_H
+#define ZTE_SOLVE_SOLVE_STATS_H
+
+// 调度器内部的计数与计时：编译时定义ZTE_SOLVE_STATS才启用（g++ -DZTE_SOLVE_STATS），
+// 否则所有埋点宏都展开为空，正常求解没有任何额外开销
+// 启用时统计写入当前线程通过StatsScope登记的SolveStats，没有登记时只多一次判空
+
+#include <algorithm>
+#include <chrono>
+#include <ostream>
+
+// 一次求解的统计
+class SolveStats {
+public:
+    // 到达的流数
+    long long arrivals = 0;
+    // 模拟到的最后时刻，以及实际处理过的时刻数（update_ports的调用次数），两者之比反映跳过空闲时间的效果
+    long long ticks = 0;
+    long long update_calls = 0;
+    // put_flow的调用次数，以及为这些调用选择端口时查看的端口数
+    long long put_flow_probes = 0;
+    long long port_visits = 0;
+    // check_flows中发出成功与失败的次数
+    long long check_successes = 0;
+    long long check_failures = 0;
+    // 调度区满时主动抛弃到排队区满的端口的流数，以及排队区已满、在端口上被抛弃的流数
+    long long discards = 0;
+    long long queue_drops = 0;
+    // fill_freed_ports发出的流数
+    long long fills = 0;
+    // 调度区与单个端口排队区的峰值长度
+    long long peak_pool_size = 0;
+    long long peak_queue_length = 0;
+    // 各阶段的墙上时间（秒）：更新端口（模拟），填充释放的端口、流进入调度区与抛弃、check_flows（搜索）
+    double update_time = 0;
+    double fill_time = 0;
+    double admit_time = 0;
+    double check_time = 0;
+
+public:
+    // 以一个JSON对象写出
+    void write_json(std::ostream &out) const {
+        out << "{\n"
+            << "  \"arrivals\": " << arrivals << ",\n"
+            << "  \"ticks\": " << ticks << ",\n"
+            << "  \"update_calls\": " << update_calls << ",\n"
+            << "  \"put_flow_probes\": " << put_flow_probes << ",\n"
+            << "  \"port_visits\": " << port_visits << ",\n"
+            << "  \"port_visits_per_probe\": "
+            << (put_flow_probes > 0 ? (double) port_visits / (double) put_flow_probes : 0.0) << ",\n"
+            << "  \"check_successes\": " << check_successes << ",\n"
+            << "  \"check_failures\": " << check_failures << ",\n"
+            << "  \"discards\": " << discards << ",\n"
+            << "  \"queue_drops\": " << queue_drops << ",\n"
+            << "  \"fills\": " << fills << ",\n"
+            << "  \"peak_pool_size\": " << peak_pool_size << ",\n"
+            << "  \"peak_queue_length\": " << peak_queue_length << ",\n"
+            << "  \"phase_time\": {\"update\": " << update_time << ", \"fill\": " << fill_time << ", \"admit\": "
+            << admit_time << ", \"check\": " << check_time << "}\n"
+            << "}\n";
+    }
+};
+
+#ifdef ZTE_SOLVE_STATS
+
+constexpr bool SOLVE_STATS_ENABLED = true;
+
+// 当前线程登记的统计，多个数据集并发求解时互不影响
+inline thread_local SolveStats *solve_stats = nullptr;
+
+// 作用域内累计墙上时间
+class StatsTimer {
+public:
+    explicit StatsTimer(double *total) {
+        this->total = total;
+        if (total != nullptr) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~StatsTimer() {
+        if (total != nullptr) {
+            *total += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+
+private:
+    double *total;
+    std::chrono::steady_clock::time_point start;
+};
+
+#define SOLVE_COUNT(field, n) \
+    do { if (solve_stats != nullptr) solve_stats->field += (n); } while (0)
+#define SOLVE_PEAK(field, value) \
+    do { if (solve_stats != nullptr) solve_stats->field = std::max<long long>(solve_stats->field, (value)); } while (0)
+#define SOLVE_TIMER(field) \
+    StatsTimer stats_timer_##field(solve_stats != nullptr ? &solve_stats->field : nullptr)
+
+#else
+
+constexpr bool SOLVE_STATS_ENABLED = false;
+
+#define SOLVE_COUNT(field, n) do {} while (0)
+#define SOLVE_PEAK(field, value) do {} while (0)
+#define SOLVE_TIMER(field) do {} while (0)
+
+#endif
+
+// 在作用域内把stats登记为当前线程的统计，未启用统计时什么也不做
+class StatsScope {
+public:
+    explicit StatsScope(SolveStats &stats) {
+#ifdef ZTE_SOLVE_STATS
+        previous = solve_stats;
+        solve_stats = &stats;
+#else
+        (void) stats;
+#endif
+    }
+
+    ~StatsScope() {
+#ifdef ZTE_SOLVE_STATS
+        solve_stats = previous;
+#endif
+    }
+
+private:
+#ifdef ZTE_SOLVE_STATS
+    SolveStats *previous;
+#endif
+};
+
+#endif //ZTE_SOLVE_SOLVE_STATS_H
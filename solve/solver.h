@@ -0,0 +1,2113 @@
+#ifndef ZTE_SOLVE_SOLVER_H
+#define ZTE_SOLVE_SOLVER_H
+
+// 流调度算法：读入数据、端口池、调度区与solve()主循环，求解程序与基准测试共用
+
+#include <iostream>
+#include <algorithm>
+#include <limits>
+#include <climits>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "../common/inline_ring.h"
+#include "../common/loader.h"
+#include "../common/result_sink.h"
+#include "../common/scorer.h"
+#include "port_scan.h"
+#include "solve_stats.h"
+
+class Flow {
+public:
+    int id;
+    int bandwidth;
+    int coming_time;
+    int occupied_time; // 在端口上的占用时间
+public:
+    Flow(int id, int bandwidth, int coming_time, int occupied_time) {
+        this->id = id;
+        this->bandwidth = bandwidth;
+        this->coming_time = coming_time;
+        this->occupied_time = occupied_time;
+    }
+};
+
+class Port {
+public:
+    int id;
+    // 端口的最大（初始）带宽
+    int max_bandwidth;
+    // 端口的当前空闲带宽
+    int bandwidth_capacity;
+    // 端口的排队区，存放流在FlowTable中的下标；容量不超过PORT_QUEUE_LIMIT，直接存放在端口内
+    // 回滚时要把流放回队首，环形队列两端都能进出
+    InlineRing<uint32_t, PORT_QUEUE_LIMIT> wait_queue;
+
+public:
+    Port(int id, int bandwidth_capacity) {
+        this->id = id;
+        this->max_bandwidth = bandwidth_capacity;
+        this->bandwidth_capacity = bandwidth_capacity;
+    }
+};
+
+inline void read_ports(const std::string &data_path, std::vector<Port> &ports) {
+    CsvFile file;
+    // 读取ports.txt，跳过首行
+    if (file.open(data_path + "/port.txt", true)) {
+        ports.reserve(file.row_hint());
+        int row[2];
+        while (file.next(row)) {
+            // 添加到ports
+            ports.emplace_back(row[0], row[1]);
+        }
+        if (file.failed()) {
+            std::cerr << data_path << "/port.txt: bad line " << file.bad_line() << std::endl;
+        }
+    }
+}
+
+inline void read_files(const std::string &data_path, std::vector<Flow> &flows, std::vector<Port> &ports) {
+    CsvFile file;
+    // 读取flows.txt，跳过首行
+    if (file.open(data_path + "/flow.txt", true)) {
+        flows.reserve(file.row_hint());
+        int row[4];
+        while (file.next(row)) {
+            // 添加到flows
+            flows.emplace_back(row[0], row[1], row[2], row[3]);
+        }
+        if (file.failed()) {
+            std::cerr << data_path << "/flow.txt: bad line " << file.bad_line() << std::endl;
+        }
+    }
+    read_ports(data_path, ports);
+}
+
+// 撤销日志：有打开的快照时记录每个修改，回滚时按相反顺序撤销到快照处
+// 没有打开的快照时record只是一次判断，不影响正常调度的开销；快照可以嵌套
+template<typename Change>
+class Journal {
+public:
+    bool recording() const {
+        return !marks.empty();
+    }
+
+    // 打开一个快照，返回其位置
+    size_t open() {
+        marks.push_back(changes.size());
+        return changes.size();
+    }
+
+    // 关闭最内层的快照，保留其后的修改；所有快照都关闭后清空日志
+    void close() {
+        marks.pop_back();
+        if (marks.empty()) {
+            changes.clear();
+        }
+    }
+
+    void record(const Change &change) {
+        if (!marks.empty()) {
+            changes.push_back(change);
+        }
+    }
+
+    // 从后往前撤销位置mark之后的修改，undo撤销一个修改，期间不得再记录
+    template<typename Undo>
+    void rollback(size_t mark, Undo undo) {
+        while (changes.size() > mark) {
+            Change change = std::move(changes.back());
+            changes.pop_back();
+            undo(change);
+        }
+    }
+
+private:
+    std::vector<Change> changes;
+    std::vector<size_t> marks;
+};
+
+// 调度中的流按列存放在FlowTable中，调度区与排队区只保存32位下标，不再整体拷贝Flow
+// 发送时间与端口在决策时直接写出，不必保存；流发出后归还下标，表的大小只与尚未发出的流数成正比
+class FlowTable {
+public:
+    std::vector<int> id;
+    std::vector<int> bandwidth;
+    std::vector<int> occupied_time;
+
+public:
+    // 存入一个流，优先复用已发出的流的下标
+    uint32_t add(const Flow &flow) {
+        uint32_t index;
+        if (!free_list.empty()) {
+            index = free_list.back();
+            free_list.pop_back();
+            // 下标可能是快照后才归还的，回滚后又要用到原来的值
+            journal.record(Change{Change::REUSE, index, id[index], bandwidth[index], occupied_time[index]});
+            id[index] = flow.id;
+            bandwidth[index] = flow.bandwidth;
+            occupied_time[index] = flow.occupied_time;
+        } else {
+            index = (uint32_t) id.size();
+            journal.record(Change{Change::APPEND, index, 0, 0, 0});
+            id.push_back(flow.id);
+            bandwidth.push_back(flow.bandwidth);
+            occupied_time.push_back(flow.occupied_time);
+        }
+        return index;
+    }
+
+    // 流已发出，下标可以复用
+    void release(uint32_t index) {
+        free_list.push_back(index);
+        journal.record(Change{Change::RELEASE, index, 0, 0, 0});
+    }
+
+    size_t open_journal() {
+        return journal.open();
+    }
+
+    void close_journal() {
+        journal.close();
+    }
+
+    // 撤销位置mark之后的add与release；复用的下标恢复原值并放回空闲表，新增的下标从表尾去掉
+    void rollback(size_t mark) {
+        journal.rollback(mark, [&](const Change &change) {
+            switch (change.kind) {
+                case Change::REUSE:
+                    id[change.index] = change.id;
+                    bandwidth[change.index] = change.bandwidth;
+                    occupied_time[change.index] = change.occupied_time;
+                    free_list.push_back(change.index);
+                    break;
+                case Change::APPEND:
+                    id.pop_back();
+                    bandwidth.pop_back();
+                    occupied_time.pop_back();
+                    break;
+                case Change::RELEASE:
+                    free_list.pop_back();
+                    break;
+            }
+        });
+    }
+
+private:
+    class Change {
+    public:
+        enum Kind {
+            // 复用了下标index，记录其原值
+            REUSE,
+            APPEND,
+            RELEASE,
+        };
+        Kind kind;
+        uint32_t index;
+        int id;
+        int bandwidth;
+        int occupied_time;
+    };
+
+    std::vector<uint32_t> free_list;
+    Journal<Change> journal;
+};
+
+// 流在time时刻开始占用端口，经过occupied_time后，还需再过一个时间单位才在update_ports中释放带宽
+inline int release_time(int time, int occupied_time) {
+    return time + occupied_time + 1;
+}
+
+// 已发送流对端口的占用：到release_time时刻释放端口port上的bandwidth带宽
+class Occupy {
+public:
+    int release_time;
+    int port;
+    int bandwidth;
+
+public:
+    Occupy(int release_time, int port, int bandwidth) {
+        this->release_time = release_time;
+        this->port = port;
+        this->bandwidth = bandwidth;
+    }
+};
+
+// occupies的排序仿函数，释放时刻早的在堆顶
+class occupies_cmp {
+public:
+    bool operator()(const Occupy &a, const Occupy &b) const {
+        return a.release_time > b.release_time;
+    }
+};
+
+// flows的排序规则，到达时间总是第一关键字
+enum class FlowOrder {
+    // occupied_time升序->bandwidth降序
+    OCCUPIED_THEN_BANDWIDTH,
+    // bandwidth降序->occupied_time升序
+    BANDWIDTH_THEN_OCCUPIED,
+    // 保持输入顺序
+    INPUT,
+};
+
+// 调度区未满时为流选择端口的策略，均只在带宽容量足够的端口中选择
+enum class Placement {
+    // 带宽容量最小的端口
+    BEST_FIT,
+    // 带宽容量最大的端口
+    WORST_FIT,
+    // 放入本流后端口上所有流的结束时刻最早的端口，相同时取带宽容量最小的
+    EARLIEST_FINISH,
+};
+
+// 调度策略中的可调参数，默认值即手工调好的原始参数
+class SolveConfig {
+public:
+    // 调度区容量为端口数的倍数，不超过赛题规定的POOL_SIZE_PER_PORT
+    int pool_factor = POOL_SIZE_PER_PORT;
+    // 带宽发生变化时check_flows查看的流数
+    int see_num_changed = 5;
+    // 带宽未变化时check_flows查看的流数
+    int see_num_unchanged = 1;
+    // 调度区满时，首流带宽大于平均带宽的discard_ratio倍才会被抛弃，取无穷大时从不主动抛弃
+    double discard_ratio = 1.0;
+    // 端口排队区容量，不超过赛题规定的PORT_QUEUE_LIMIT
+    int port_queue_cap = PORT_QUEUE_LIMIT;
+    FlowOrder flow_order = FlowOrder::OCCUPIED_THEN_BANDWIDTH;
+    // 带宽释放时是否按带宽索引用调度区中的流填满端口，否则只靠check_flows查看调度区前几个流
+    bool fill_freed_ports = true;
+    Placement placement = Placement::BEST_FIT;
+    // 同一时刻到达的流是否先全部进入调度区，再对整个调度区按带宽降序做一遍最佳适配装箱，之后才用check_flows
+    bool batch_admission = false;
+};
+
+// 端口在有序索引中的键，按(bandwidth_capacity, order)排序，各端口的order互不相同
+class PortKey {
+public:
+    int capacity;
+    int order;
+    int index;
+
+public:
+    bool operator<(const PortKey &other) const {
+        return capacity < other.capacity || (capacity == other.capacity && order < other.order);
+    }
+};
+
+// 端口池：端口存放在固定数组中，不再整体拷贝
+// 端口数不超过扫描内核的port_limit时，端口选择在按列存放的端口表上向量化扫描，容量更新为O(1)；
+// 否则另按(bandwidth_capacity, order)维护有序索引，最佳适配查询与容量更新均为O(logP)
+// 带宽容量相同的端口按order排序，复现原先multiset中端口的先后：每个端口取出再放回时排到同容量端口的末尾
+class PortPool {
+public:
+    std::vector<Port> ports;
+
+public:
+    // queue_cap为每个端口排队区的容量，不能超过排队区本身的容量PORT_QUEUE_LIMIT
+    PortPool(const std::vector<Port> &ports, int queue_cap)
+            : ports(ports), busy_until(ports.size(), 0), order(ports.size()), moving(ports.size(), false) {
+        this->queue_cap = std::min(queue_cap, PORT_QUEUE_LIMIT);
+        // 初始按输入顺序
+        for (int i = 0; i < size(); i++) {
+            const Port &port = this->ports[i];
+            order[i] = i;
+            table.add(port.bandwidth_capacity, port.max_bandwidth, (int) port.wait_queue.size(), i);
+            full_count += (int) port.wait_queue.size() >= queue_cap;
+        }
+        order_high = size() - 1;
+        scan = size() <= table.port_limit();
+        if (!scan) {
+            build_indexes();
+        }
+    }
+
+    // 加入一个端口，不使用扫描时逐个插入索引，均摊O(log^2 P)；不能在有打开的快照时调用
+    void add_port(const Port &port) {
+        reserve_orders(1);
+        ports.push_back(port);
+        busy_until.push_back(0);
+        order.push_back(++order_high);
+        moving.push_back(false);
+        table.add(port.bandwidth_capacity, port.max_bandwidth, (int) port.wait_queue.size(), order.back());
+        full_count += (int) port.wait_queue.size() >= queue_cap;
+        if (scan) {
+            // 端口数刚超过port_limit时改为维护索引
+            scan = size() <= table.port_limit();
+            if (!scan) {
+                build_indexes();
+            }
+            return;
+        }
+        by_capacity.insert(key(size() - 1));
+        add_max_port(size() - 1);
+    }
+
+    int size() const {
+        return (int) ports.size();
+    }
+
+    // 是否在端口表上扫描，而不是查询有序索引
+    bool scanning() const {
+        return scan;
+    }
+
+    // 排队区为空的端口中最大的带宽容量，没有这样的端口时返回-1
+    // 不扫描时从容量最大的端口往下跳过排队区非空的端口，只在调度区满、端口排着队时才会多走几步
+    int idle_max_capacity() const {
+        if (scan) {
+            SOLVE_COUNT(port_visits, 1);
+            return table.idle_max_capacity();
+        }
+        for (auto it = by_capacity.rbegin(); it != by_capacity.rend(); ++it) {
+            SOLVE_COUNT(port_visits, 1);
+            if (ports[it->index].wait_queue.empty()) {
+                return it->capacity;
+            }
+        }
+        return -1;
+    }
+
+    // 排队区为空、且带宽容量不小于bandwidth的端口中(bandwidth_capacity, order)最小的一个，不存在时返回-1
+    // 排队区非空的端口留给排队的流；不扫描时同样跳过这些端口
+    int idle_best_fit(int bandwidth) const {
+        if (scan) {
+            SOLVE_COUNT(port_visits, 1);
+            return table.idle_best_fit(bandwidth);
+        }
+        for (auto it = by_capacity.lower_bound(PortKey{bandwidth, INT_MIN, -1}); it != by_capacity.end(); ++it) {
+            SOLVE_COUNT(port_visits, 1);
+            if (ports[it->index].wait_queue.empty()) {
+                return it->index;
+            }
+        }
+        return -1;
+    }
+
+    // 带宽容量不小于bandwidth的端口中(bandwidth_capacity, order)最小的一个，不存在时返回-1
+    int best_fit(int bandwidth) const {
+        SOLVE_COUNT(port_visits, 1);
+        if (scan) {
+            return table.best_fit(bandwidth);
+        }
+        auto it = by_capacity.lower_bound(PortKey{bandwidth, INT_MIN, -1});
+        return it == by_capacity.end() ? -1 : it->index;
+    }
+
+    // (bandwidth_capacity, order)最大的端口，其容量小于bandwidth时返回-1
+    int worst_fit(int bandwidth) const {
+        SOLVE_COUNT(port_visits, 1);
+        if (scan) {
+            int index = table.widest();
+            return index < 0 || ports[index].bandwidth_capacity < bandwidth ? -1 : index;
+        }
+        if (by_capacity.empty() || by_capacity.rbegin()->capacity < bandwidth) {
+            return -1;
+        }
+        return by_capacity.rbegin()->index;
+    }
+
+    // 带宽容量不小于bandwidth的端口中，time时刻放入占用occupied_time的流后，端口上所有流结束最早的一个
+    // 按带宽容量升序查找，遇到结束时刻不晚于本流自身结束时刻的端口即可停止
+    int earliest_finish(int bandwidth, int time, int occupied_time) const {
+        int finish = release_time(time, occupied_time);
+        int best = -1;
+        int best_finish = INT_MAX;
+        if (scan) {
+            // 等价于按(结束时刻, bandwidth_capacity, order)取最小
+            for (int i = 0; i < size(); i++) {
+                int capacity = ports[i].bandwidth_capacity;
+                if (capacity < bandwidth) {
+                    continue;
+                }
+                SOLVE_COUNT(port_visits, 1);
+                int port_finish = std::max(busy_until[i], finish);
+                if (port_finish < best_finish || (port_finish == best_finish && key(i) < key(best))) {
+                    best = i;
+                    best_finish = port_finish;
+                }
+            }
+            return best;
+        }
+        for (auto it = by_capacity.lower_bound(PortKey{bandwidth, INT_MIN, -1}); it != by_capacity.end(); ++it) {
+            SOLVE_COUNT(port_visits, 1);
+            int port_finish = std::max(busy_until[it->index], finish);
+            if (port_finish < best_finish) {
+                best = it->index;
+                best_finish = port_finish;
+                if (port_finish == finish) {
+                    break;
+                }
+            }
+        }
+        return best;
+    }
+
+    // 按带宽容量升序，第一个最大带宽不小于bandwidth的端口，不存在时返回-1
+    // 即最大带宽不小于bandwidth的端口中(bandwidth_capacity, order)最小的一个，在按最大带宽排列的线段树上查询后缀，O(logP)
+    int first_max_fit(int bandwidth) const {
+        SOLVE_COUNT(port_visits, 1);
+        if (scan) {
+            return table.first_max_fit(bandwidth);
+        }
+        return max_suffix_min(false, bandwidth);
+    }
+
+    // 是否还有未释放的占用
+    bool any_occupied() const {
+        return !occupies.empty();
+    }
+
+    // 释放时刻最早的占用
+    const Occupy &next_occupy() const {
+        return occupies.front();
+    }
+
+    // 移除释放时刻最早的占用
+    void pop_occupy() {
+        Occupy last = occupies.back();
+        journal.record(Change(Change::HEAP_POP, 0, 0, last));
+        occupies.pop_back();
+        if (occupies.empty()) {
+            return;
+        }
+        // 末尾的占用从堆顶下沉
+        size_t hole = 0;
+        while (2 * hole + 1 < occupies.size()) {
+            size_t child = 2 * hole + 1;
+            if (child + 1 < occupies.size() && occupies[child + 1].release_time < occupies[child].release_time) {
+                child++;
+            }
+            if (occupies[child].release_time >= last.release_time) {
+                break;
+            }
+            set_occupy(hole, occupies[child]);
+            hole = child;
+        }
+        set_occupy(hole, last);
+    }
+
+    // 带宽为bandwidth的流在time时刻开始占用端口index，占用occupied_time
+    void occupy(int index, int time, int bandwidth, int occupied_time) {
+        Occupy occupy(release_time(time, occupied_time), index, bandwidth);
+        journal.record(Change(Change::HEAP_PUSH, 0, 0, occupy));
+        occupies.push_back(occupy);
+        // 新的占用从堆底上浮
+        size_t hole = occupies.size() - 1;
+        while (hole > 0 && occupies[(hole - 1) / 2].release_time > occupy.release_time) {
+            set_occupy(hole, occupies[(hole - 1) / 2]);
+            hole = (hole - 1) / 2;
+        }
+        set_occupy(hole, occupy);
+        if (busy_until[index] < occupy.release_time) {
+            journal.record(Change(Change::BUSY, index, busy_until[index]));
+            busy_until[index] = occupy.release_time;
+        }
+        change_capacity(index, -bandwidth);
+    }
+
+    bool queue_full(int index) const {
+        return (int) ports[index].wait_queue.size() >= queue_cap;
+    }
+
+    // 流加入端口index的排队区，排队区满时记入full_tree
+    void push_queue(int index, uint32_t flow) {
+        journal.record(Change(Change::QUEUE_PUSH, index, 0));
+        ports[index].wait_queue.push_back(flow);
+        SOLVE_PEAK(peak_queue_length, ports[index].wait_queue.size());
+        queue_changed(index, 1);
+    }
+
+    // 端口index排队区的首流离开排队区
+    void pop_queue(int index) {
+        journal.record(Change(Change::QUEUE_POP, index, (int) ports[index].wait_queue.front()));
+        ports[index].wait_queue.pop_front();
+        queue_changed(index, -1);
+    }
+
+    // 是否有排队区满的端口
+    bool any_queue_full() const {
+        return full_count > 0;
+    }
+
+    // 按带宽容量升序，第一个排队区满、且最大带宽不小于bandwidth的端口，不存在时返回-1
+    // 即这些端口中(bandwidth_capacity, order)最小的一个，与first_max_fit同样在按最大带宽排列的线段树上查询后缀
+    int full_queue_fit(int bandwidth) const {
+        if (scan) {
+            return table.full_queue_fit(bandwidth, queue_cap);
+        }
+        return max_suffix_min(true, bandwidth);
+    }
+
+    // 端口带宽容量变化delta，同时更新索引
+    // 更新期间只改端口表，记下端口原来的键，由end_update统一排定次序并更新有序索引；其余时候端口排到新容量的同容量端口末尾
+    void change_capacity(int index, int delta) {
+        journal.record(Change(Change::CAPACITY, index, delta));
+        int capacity = ports[index].bandwidth_capacity + delta;
+        if (updating) {
+            if (!moving[index]) {
+                moving[index] = true;
+                moved.push_back(key(index));
+            }
+            ports[index].bandwidth_capacity = capacity;
+            table.capacity[index] = capacity;
+        } else {
+            reserve_orders(1);
+            journal.record(Change(Change::ORDER, index, order[index]));
+            set_key(index, capacity, ++order_high);
+        }
+    }
+
+    // 流进入端口index的排队区或在此被抛弃后，原先放在它前面的同容量端口与它自己依次排到同容量端口的末尾
+    // 原先选择端口时，这些端口都从multiset中取出后按顺序放回
+    void requeue(int index) {
+        std::vector<PortKey> &passed = reordered;
+        passed.clear();
+        int capacity = ports[index].bandwidth_capacity;
+        if (scan) {
+            for (int i = 0; i < size(); i++) {
+                if (ports[i].bandwidth_capacity == capacity && order[i] < order[index]) {
+                    passed.push_back(key(i));
+                }
+            }
+            std::sort(passed.begin(), passed.end());
+        } else {
+            for (auto it = by_capacity.lower_bound(PortKey{capacity, INT_MIN, -1}); it->index != index; ++it) {
+                passed.push_back(*it);
+            }
+        }
+        passed.push_back(key(index));
+        reserve_orders((int) passed.size());
+        for (auto &port_key: passed) {
+            set_order(port_key.index, ++order_high);
+        }
+    }
+
+    // 开始一次更新：上一次更新留下的活跃端口放入check_ports，清空活跃端口与释放端口
+    // 有打开的快照时只把两者的起点移到末尾并记下原来的起点与长度，不拷贝内容
+    void begin_update(std::vector<int> &check_ports) {
+        check_ports.assign(active_ports.begin() + active_begin, active_ports.end());
+        if (journal.recording()) {
+            journal.record(Change(Change::ACTIVE, active_begin, (int) active_ports.size()));
+            journal.record(Change(Change::FREED, freed_begin, (int) freed_ports.size()));
+            active_begin = (int) active_ports.size();
+            freed_begin = (int) freed_ports.size();
+        } else {
+            active_ports.clear();
+            freed_ports.clear();
+            active_begin = 0;
+            freed_begin = 0;
+        }
+        updating = true;
+    }
+
+    // 端口index本次更新中从排队区发出了流且排队区仍非空，下一个时间单位需要再检查
+    void add_active(int index) {
+        active_ports.push_back(index);
+    }
+
+    // 端口index本次更新中有流释放带宽
+    void add_freed(int index) {
+        freed_ports.push_back(index);
+    }
+
+    bool any_active() const {
+        return (int) active_ports.size() > active_begin;
+    }
+
+    // 上一次更新中有流释放带宽的端口数，这些端口按下标升序由freed_port(0..freed_count()-1)给出
+    int freed_count() const {
+        return (int) freed_ports.size() - freed_begin;
+    }
+
+    int freed_port(int i) const {
+        return freed_ports[freed_begin + i];
+    }
+
+    // 结束一次更新，相当于原先把所有端口按原顺序取出再逐个放回：容量变大的端口排到新容量的同容量端口之前，
+    // 容量变小的排到其后，各自之间保持原顺序；容量最终未变的端口位置不变
+    void end_update() {
+        updating = false;
+        std::sort(freed_ports.begin() + freed_begin, freed_ports.end());
+        freed_ports.erase(std::unique(freed_ports.begin() + freed_begin, freed_ports.end()), freed_ports.end());
+        if (moved.empty()) {
+            return;
+        }
+        // 重新编号时按端口当前的容量重建了索引，否则索引中还是各端口原来的键
+        bool rebuilt = reserve_orders((int) moved.size());
+        if (!scan) {
+            for (auto &old_key: moved) {
+                by_capacity.erase(rebuilt ? key(old_key.index) : old_key);
+            }
+        }
+        // 原来的键按原顺序排列，容量变大的从后往前依次排到最前，容量变小的从前往后依次排到末尾
+        std::sort(moved.begin(), moved.end());
+        for (auto it = moved.rbegin(); it != moved.rend(); ++it) {
+            if (ports[it->index].bandwidth_capacity > it->capacity) {
+                renumber_port(it->index, --order_low);
+            }
+        }
+        for (auto &old_key: moved) {
+            moving[old_key.index] = false;
+            if (ports[old_key.index].bandwidth_capacity < old_key.capacity) {
+                renumber_port(old_key.index, ++order_high);
+            }
+            if (!scan) {
+                by_capacity.insert(key(old_key.index));
+                set_max_leaf(false, old_key.index, key(old_key.index));
+                if (queue_full(old_key.index)) {
+                    set_max_leaf(true, old_key.index, key(old_key.index));
+                }
+            }
+        }
+        moved.clear();
+    }
+
+    size_t open_journal() {
+        return journal.open();
+    }
+
+    void close_journal() {
+        journal.close();
+    }
+
+    // 撤销位置mark之后的修改；端口表按原值写回，by_capacity是有序集合，按相反的操作恢复即可
+    void rollback(size_t mark) {
+        journal.rollback(mark, [&](Change &change) {
+            switch (change.kind) {
+                case Change::HEAP_SET:
+                    occupies[change.index] = change.occupy;
+                    break;
+                case Change::HEAP_PUSH:
+                    occupies.pop_back();
+                    break;
+                case Change::HEAP_POP:
+                    occupies.push_back(change.occupy);
+                    break;
+                case Change::BUSY:
+                    busy_until[change.index] = change.value;
+                    break;
+                case Change::CAPACITY:
+                    set_key(change.index, ports[change.index].bandwidth_capacity - change.value, order[change.index]);
+                    break;
+                case Change::ORDER:
+                    if (renumbering) {
+                        order[change.index] = change.value;
+                    } else {
+                        set_key(change.index, ports[change.index].bandwidth_capacity, change.value);
+                    }
+                    break;
+                case Change::RENUMBERED:
+                    order_high = change.index;
+                    order_low = change.value;
+                    renumbering = true;
+                    break;
+                case Change::RENUMBER:
+                    renumbering = false;
+                    rebuild_orders();
+                    break;
+                case Change::QUEUE_PUSH:
+                    ports[change.index].wait_queue.pop_back();
+                    queue_changed(change.index, -1);
+                    break;
+                case Change::QUEUE_POP:
+                    ports[change.index].wait_queue.push_front((uint32_t) change.value);
+                    queue_changed(change.index, 1);
+                    break;
+                case Change::ACTIVE:
+                    active_ports.resize(change.value);
+                    active_begin = change.index;
+                    break;
+                case Change::FREED:
+                    freed_ports.resize(change.value);
+                    freed_begin = change.index;
+                    break;
+            }
+        });
+    }
+
+private:
+    // 对端口池的一个修改，回滚时据此恢复
+    class Change {
+    public:
+        enum Kind {
+            // 堆的一个位置被改写，occupy为原值
+            HEAP_SET,
+            HEAP_PUSH,
+            // 弹出前堆的最后一个元素为occupy
+            HEAP_POP,
+            // busy_until[index]原为value
+            BUSY,
+            // 端口index的带宽容量变化了value
+            CAPACITY,
+            // 端口index的order原为value
+            ORDER,
+            // 重新编号的开始与结束，其间是各端口的ORDER；中途各端口的order会重复，只在两端整体重建索引
+            RENUMBER,
+            // 重新编号前order_high为index、order_low为value，回滚后的order都在其间
+            RENUMBERED,
+            QUEUE_PUSH,
+            // 端口index的排队区首流value离开
+            QUEUE_POP,
+            // 更新开始前active_ports与freed_ports的起点为index、长度为value
+            ACTIVE,
+            FREED,
+        };
+        Kind kind;
+        int index;
+        int value;
+        Occupy occupy;
+
+    public:
+        Change(Kind kind, int index, int value, const Occupy &occupy = Occupy(0, 0, 0)) : occupy(occupy) {
+            this->kind = kind;
+            this->index = index;
+            this->value = value;
+        }
+    };
+
+    // 所有端口中已发送的流，按释放时刻组织成一个小根堆，节点存放在同一块连续内存中
+    // 释放带宽时只访问到时的流，不再逐个时间单位递减每个流的剩余时间；上浮下沉逐个位置改写，以便回滚
+    std::vector<Occupy> occupies;
+    // 上一次更新中从排队区发出了流、且排队区仍非空的端口，从active_begin开始
+    // 上一次更新中有流释放带宽的端口，从freed_begin开始，升序
+    // 有打开的快照时两者只在末尾追加，回滚时截断并恢复起点；没有快照时每次更新前清空
+    std::vector<int> active_ports;
+    int active_begin = 0;
+    std::vector<int> freed_ports;
+    int freed_begin = 0;
+    // 按列存放的带宽容量、最大带宽与排队区长度，始终与ports同步
+    PortTable table;
+    bool scan = true;
+    // 以下索引只在不扫描时维护
+    std::set<PortKey> by_capacity;
+    // 每个端口上已发送的流中最晚的释放时刻
+    std::vector<int> busy_until;
+    // 同容量端口间的先后，排到末尾取++order_high，排到最前取--order_low；快用完时按现有顺序重新编号
+    std::vector<int> order;
+    int order_high = -1;
+    int order_low = 0;
+    // 回滚重新编号的过程中
+    bool renumbering = false;
+    // 更新期间容量变化过的端口及其原来的键
+    bool updating = false;
+    std::vector<bool> moving;
+    std::vector<PortKey> moved;
+    // requeue中依次排到末尾的端口
+    std::vector<PortKey> reordered;
+    int queue_cap;
+    // 排队区满的端口数，随排队区的进出增量维护
+    int full_count = 0;
+    // 按最大带宽的索引分为若干层，每层内端口按(max_bandwidth, 下标)升序排列：排序后的最大带宽，
+    // 以及名次上的PortKey最小值线段树，full_tree的叶子只保留排队区满的端口，其余为NO_PORT
+    // 新加入的端口单独成一层，再与不比它大的末层逐个归并，层的大小从前往后至少减半，共O(logP)层
+    class MaxLevel {
+    public:
+        std::vector<int> sorted;
+        std::vector<int> max_sorted;
+        std::vector<PortKey> max_tree;
+        std::vector<PortKey> full_tree;
+        int leaves = 1;
+    };
+
+    std::vector<MaxLevel> max_levels;
+    // 各端口所在的层与层内的名次
+    std::vector<int> max_level;
+    std::vector<int> max_rank;
+    Journal<Change> journal;
+
+    void set_occupy(size_t position, const Occupy &occupy) {
+        if (journal.recording()) {
+            journal.record(Change(Change::HEAP_SET, (int) position, 0, occupies[position]));
+        }
+        occupies[position] = occupy;
+    }
+
+    // 线段树的空叶子
+    static constexpr PortKey NO_PORT{INT_MAX, INT_MAX, -1};
+
+    PortKey key(int index) const {
+        return PortKey{ports[index].bandwidth_capacity, order[index], index};
+    }
+
+    // 端口index的带宽容量改为capacity、order改为port_order，同时更新端口表与索引
+    void set_key(int index, int capacity, int port_order) {
+        Port &port = ports[index];
+        if (!scan) {
+            by_capacity.erase(key(index));
+        }
+        port.bandwidth_capacity = capacity;
+        order[index] = port_order;
+        table.capacity[index] = capacity;
+        table.order[index] = port_order;
+        if (scan) {
+            return;
+        }
+        by_capacity.insert(key(index));
+        set_max_leaf(false, index, key(index));
+        if (queue_full(index)) {
+            set_max_leaf(true, index, key(index));
+        }
+    }
+
+    void set_order(int index, int port_order) {
+        journal.record(Change(Change::ORDER, index, order[index]));
+        set_key(index, ports[index].bandwidth_capacity, port_order);
+    }
+
+    // 只改order与端口表，由调用者更新有序索引
+    void renumber_port(int index, int port_order) {
+        journal.record(Change(Change::ORDER, index, order[index]));
+        order[index] = port_order;
+        table.order[index] = port_order;
+    }
+
+    // 保证还能取count个新的order，否则按现有顺序把order重新编号为0..P-1并重建索引，返回是否重新编号了
+    // 重新编号为O(PlogP)，要到约2^31次取用后才发生
+    bool reserve_orders(int count) {
+        if (order_high <= INT_MAX - count && order_low >= INT_MIN + 1 + count) {
+            return false;
+        }
+        std::vector<int> sorted(ports.size());
+        for (int i = 0; i < size(); i++) {
+            sorted[i] = i;
+        }
+        std::sort(sorted.begin(), sorted.end(), [&](int a, int b) {
+            return order[a] < order[b];
+        });
+        journal.record(Change(Change::RENUMBER, 0, 0));
+        for (int rank = 0; rank < size(); rank++) {
+            renumber_port(sorted[rank], rank);
+        }
+        journal.record(Change(Change::RENUMBERED, order_high, order_low));
+        order_high = size() - 1;
+        order_low = 0;
+        rebuild_orders();
+        return true;
+    }
+
+    // order整体改变后重建端口表的order列与索引
+    void rebuild_orders() {
+        for (int i = 0; i < size(); i++) {
+            table.order[i] = order[i];
+        }
+        if (!scan) {
+            build_indexes();
+        }
+    }
+
+    // 端口index所在层的max_tree（full为true时为full_tree）上的叶子改为port_key，并更新到根的路径
+    void set_max_leaf(bool full, int index, const PortKey &port_key) {
+        MaxLevel &level = max_levels[max_level[index]];
+        std::vector<PortKey> &tree = full ? level.full_tree : level.max_tree;
+        int node = level.leaves + max_rank[index];
+        tree[node] = port_key;
+        for (node >>= 1; node > 0; node >>= 1) {
+            tree[node] = std::min(tree[2 * node], tree[2 * node + 1]);
+        }
+    }
+
+    // 各层max_tree（full为true时为full_tree）上最大带宽不小于bandwidth的名次后缀中最小的叶子，
+    // 返回其端口下标，后缀均为空时返回-1
+    int max_suffix_min(bool full, int bandwidth) const {
+        PortKey best = NO_PORT;
+        for (auto &level: max_levels) {
+            const std::vector<PortKey> &tree = full ? level.full_tree : level.max_tree;
+            int left = (int) (std::lower_bound(level.max_sorted.begin(), level.max_sorted.end(), bandwidth) -
+                              level.max_sorted.begin());
+            int right = (int) level.max_sorted.size();
+            for (left += level.leaves, right += level.leaves; left < right; left >>= 1, right >>= 1) {
+                if (left & 1) {
+                    best = std::min(best, tree[left++]);
+                }
+                if (right & 1) {
+                    best = std::min(best, tree[--right]);
+                }
+            }
+        }
+        return best.index;
+    }
+
+    // 端口index的排队区长度刚变化了delta（1或-1），更新端口表与排队区满的端口
+    void queue_changed(int index, int delta) {
+        const Port &port = ports[index];
+        int length = (int) port.wait_queue.size();
+        table.queue_length[index] = length;
+        table.idle[index] = length == 0;
+        // 入队后长度为queue_cap，或出队后长度为queue_cap - 1
+        if (length != (delta > 0 ? queue_cap : queue_cap - 1)) {
+            return;
+        }
+        full_count += delta;
+        if (scan) {
+            return;
+        }
+        set_max_leaf(true, index, delta > 0 ? key(index) : NO_PORT);
+    }
+
+    // 从头建立有序索引与按最大带宽的索引
+    void build_indexes() {
+        by_capacity.clear();
+        for (int i = 0; i < size(); i++) {
+            by_capacity.insert(key(i));
+        }
+        build_max_index();
+    }
+
+    // 所有端口按(max_bandwidth, 下标)升序排成一层
+    void build_max_index() {
+        max_levels.assign(1, MaxLevel());
+        std::vector<int> &sorted = max_levels[0].sorted;
+        sorted.resize(ports.size());
+        for (int i = 0; i < (int) ports.size(); i++) {
+            sorted[i] = i;
+        }
+        std::sort(sorted.begin(), sorted.end(), [&](int a, int b) {
+            return max_less(a, b);
+        });
+        max_level.assign(ports.size(), 0);
+        max_rank.resize(ports.size());
+        build_max_level(0);
+    }
+
+    // 新端口index单独成一层，末两层中前一层不比后一层大时归并，均摊O(logP)次移动
+    void add_max_port(int index) {
+        max_level.push_back((int) max_levels.size());
+        max_rank.push_back(0);
+        max_levels.emplace_back();
+        max_levels.back().sorted.push_back(index);
+        while (max_levels.size() >= 2 &&
+               max_levels[max_levels.size() - 2].sorted.size() <= max_levels.back().sorted.size()) {
+            std::vector<int> &front = max_levels[max_levels.size() - 2].sorted;
+            std::vector<int> &back = max_levels.back().sorted;
+            std::vector<int> merged(front.size() + back.size());
+            std::merge(front.begin(), front.end(), back.begin(), back.end(), merged.begin(), [&](int a, int b) {
+                return max_less(a, b);
+            });
+            max_levels.pop_back();
+            max_levels.back().sorted.swap(merged);
+        }
+        build_max_level((int) max_levels.size() - 1);
+    }
+
+    bool max_less(int a, int b) const {
+        return std::make_pair(ports[a].max_bandwidth, a) < std::make_pair(ports[b].max_bandwidth, b);
+    }
+
+    // 按第number层已排好的端口建立其线段树，线段树的叶子为各端口的PortKey，full_tree只含排队区满的端口
+    void build_max_level(int number) {
+        MaxLevel &level = max_levels[number];
+        int count = (int) level.sorted.size();
+        level.leaves = 1;
+        while (level.leaves < count) {
+            level.leaves *= 2;
+        }
+        level.max_sorted.resize(count);
+        level.max_tree.assign(2 * level.leaves, NO_PORT);
+        level.full_tree.assign(2 * level.leaves, NO_PORT);
+        for (int rank = 0; rank < count; rank++) {
+            int index = level.sorted[rank];
+            level.max_sorted[rank] = ports[index].max_bandwidth;
+            max_level[index] = number;
+            max_rank[index] = rank;
+            level.max_tree[level.leaves + rank] = key(index);
+            if (queue_full(index)) {
+                level.full_tree[level.leaves + rank] = key(index);
+            }
+        }
+        for (int node = level.leaves - 1; node > 0; node--) {
+            level.max_tree[node] = std::min(level.max_tree[2 * node], level.max_tree[2 * node + 1]);
+            level.full_tree[node] = std::min(level.full_tree[2 * node], level.full_tree[2 * node + 1]);
+        }
+    }
+};
+
+// 调度区按带宽的索引：查询带宽不超过capacity的流中occupied_time最短的一个
+// 线段树的叶子是带宽取值，存放该带宽的流中occupied_time最小的(occupied_time, 流下标)，查询为O(logB)
+// 每个带宽的流放在一个小根堆中，删除的流只做标记，到堆顶时才真正弹出，堆顶始终是有效的流
+// 叶子数随出现过的最大带宽成倍增长，内存与之成正比
+// 堆的上浮下沉逐个位置改写并记入日志，与std::push_heap/pop_heap移动元素的方式相同；回滚时写回原值并重算线段树上的路径
+class BandwidthIndex {
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+public:
+    void insert(uint32_t flow, int bandwidth, int occupied_time) {
+        bandwidth = std::max(0, bandwidth);
+        if (flow >= flow_bandwidth.size()) {
+            flow_bandwidth.resize(flow + 1, 0);
+            stamp.resize(flow + 1, 0);
+            alive.resize(flow + 1, false);
+        }
+        if (bandwidth >= leaves) {
+            grow(bandwidth + 1);
+        }
+        journal.record(Change{Change::FLOW, flow, stamp[flow], alive[flow], flow_bandwidth[flow], 0, Entry{}});
+        // 下标会被复用，用stamp区分同一下标先后存放的不同流
+        stamp[flow]++;
+        alive[flow] = true;
+        flow_bandwidth[flow] = bandwidth;
+        std::vector<Entry> &heap = heaps[bandwidth];
+        push_entry(bandwidth, Entry{occupied_time, flow, stamp[flow]});
+        if (heap.front().flow == flow) {
+            update(bandwidth);
+        }
+    }
+
+    void erase(uint32_t flow) {
+        journal.record(Change{Change::FLOW, flow, stamp[flow], alive[flow], flow_bandwidth[flow], 0, Entry{}});
+        alive[flow] = false;
+        int bandwidth = flow_bandwidth[flow];
+        std::vector<Entry> &heap = heaps[bandwidth];
+        if (heap.front().flow != flow) {
+            return;
+        }
+        // 弹出堆顶已删除的流
+        while (!heap.empty() && (!alive[heap.front().flow] || heap.front().stamp != stamp[heap.front().flow])) {
+            pop_entry(bandwidth);
+        }
+        update(bandwidth);
+    }
+
+    // 带宽不超过capacity的流中occupied_time最短的一个，不存在时返回NONE
+    uint32_t fit(int capacity) const {
+        if (capacity < 0 || leaves == 0) {
+            return NONE;
+        }
+        // 自底向上求叶子区间[0, capacity]上的最小值
+        int left = leaves;
+        int right = std::min(capacity, leaves - 1) + leaves + 1;
+        std::pair<int, uint32_t> best(INT_MAX, NONE);
+        while (left < right) {
+            if (left & 1) {
+                best = std::min(best, tree[left++]);
+            }
+            if (right & 1) {
+                best = std::min(best, tree[--right]);
+            }
+            left >>= 1;
+            right >>= 1;
+        }
+        return best.second;
+    }
+
+    // 带宽不超过capacity的流中带宽最大的一个，同带宽时取occupied_time最短的，不存在时返回NONE
+    uint32_t widest(int capacity) const {
+        if (capacity < 0 || leaves == 0) {
+            return NONE;
+        }
+        int node = std::min(capacity, leaves - 1) + leaves;
+        if (tree[node].second != NONE) {
+            return tree[node].second;
+        }
+        // 向上找到左侧第一棵非空的兄弟子树，再沿其中靠右的非空孩子下降到叶子
+        while (node > 1 && !((node & 1) && tree[node - 1].second != NONE)) {
+            node >>= 1;
+        }
+        if (node <= 1) {
+            return NONE;
+        }
+        node--;
+        while (node < leaves) {
+            node = tree[2 * node + 1].second != NONE ? 2 * node + 1 : 2 * node;
+        }
+        return tree[node].second;
+    }
+
+    size_t open_journal() {
+        return journal.open();
+    }
+
+    void close_journal() {
+        journal.close();
+    }
+
+    void rollback(size_t mark) {
+        journal.rollback(mark, [&](const Change &change) {
+            std::vector<Entry> &heap = heaps[change.bandwidth];
+            switch (change.kind) {
+                case Change::FLOW:
+                    stamp[change.flow] = change.stamp;
+                    alive[change.flow] = change.alive;
+                    flow_bandwidth[change.flow] = change.bandwidth;
+                    break;
+                case Change::HEAP_SET:
+                    heap[change.position] = change.entry;
+                    if (change.position == 0) {
+                        update(change.bandwidth);
+                    }
+                    break;
+                case Change::HEAP_PUSH:
+                    heap.pop_back();
+                    if (heap.empty()) {
+                        update(change.bandwidth);
+                    }
+                    break;
+                case Change::HEAP_POP:
+                    heap.push_back(change.entry);
+                    if (heap.size() == 1) {
+                        update(change.bandwidth);
+                    }
+                    break;
+            }
+        });
+    }
+
+private:
+    class Entry {
+    public:
+        int occupied_time;
+        uint32_t flow;
+        uint32_t stamp;
+    };
+
+    int leaves = 0;
+    std::vector<std::pair<int, uint32_t>> tree;
+    std::vector<std::vector<Entry>> heaps;
+    std::vector<int> flow_bandwidth;
+    std::vector<uint32_t> stamp;
+    std::vector<bool> alive;
+
+    // 对索引的一个修改：流的stamp、alive与带宽的原值，或带宽bandwidth的堆上的一次改写
+    class Change {
+    public:
+        enum Kind {
+            FLOW,
+            // 堆的position位置被改写，entry为原值
+            HEAP_SET,
+            HEAP_PUSH,
+            // 弹出前堆的最后一个元素为entry
+            HEAP_POP,
+        };
+        Kind kind;
+        uint32_t flow;
+        uint32_t stamp;
+        bool alive;
+        int bandwidth;
+        uint32_t position;
+        Entry entry;
+    };
+
+    Journal<Change> journal;
+
+    void set_entry(int bandwidth, size_t position, const Entry &entry) {
+        std::vector<Entry> &heap = heaps[bandwidth];
+        if (journal.recording()) {
+            journal.record(Change{Change::HEAP_SET, 0, 0, false, bandwidth, (uint32_t) position, heap[position]});
+        }
+        heap[position] = entry;
+    }
+
+    // 新的流从堆底上浮，occupied_time小的在堆顶
+    void push_entry(int bandwidth, const Entry &entry) {
+        std::vector<Entry> &heap = heaps[bandwidth];
+        journal.record(Change{Change::HEAP_PUSH, 0, 0, false, bandwidth, 0, entry});
+        heap.push_back(entry);
+        size_t hole = heap.size() - 1;
+        while (hole > 0 && heap[(hole - 1) / 2].occupied_time > entry.occupied_time) {
+            set_entry(bandwidth, hole, heap[(hole - 1) / 2]);
+            hole = (hole - 1) / 2;
+        }
+        set_entry(bandwidth, hole, entry);
+    }
+
+    // 弹出堆顶：空位沿较小的孩子（相同时取右孩子）降到底，再把原来的最后一个元素从那里上浮
+    void pop_entry(int bandwidth) {
+        std::vector<Entry> &heap = heaps[bandwidth];
+        Entry last = heap.back();
+        journal.record(Change{Change::HEAP_POP, 0, 0, false, bandwidth, 0, last});
+        heap.pop_back();
+        if (heap.empty()) {
+            return;
+        }
+        size_t length = heap.size();
+        size_t hole = 0;
+        size_t child = 0;
+        while (child < (length - 1) / 2) {
+            child = 2 * (child + 1);
+            if (heap[child].occupied_time > heap[child - 1].occupied_time) {
+                child--;
+            }
+            set_entry(bandwidth, hole, heap[child]);
+            hole = child;
+        }
+        if ((length & 1) == 0 && child == (length - 2) / 2) {
+            child = 2 * (child + 1);
+            set_entry(bandwidth, hole, heap[child - 1]);
+            hole = child - 1;
+        }
+        while (hole > 0 && heap[(hole - 1) / 2].occupied_time > last.occupied_time) {
+            set_entry(bandwidth, hole, heap[(hole - 1) / 2]);
+            hole = (hole - 1) / 2;
+        }
+        set_entry(bandwidth, hole, last);
+    }
+
+    void grow(int bandwidths) {
+        int size = std::max(64, leaves);
+        while (size < bandwidths) {
+            size *= 2;
+        }
+        heaps.resize(size);
+        tree.assign(2 * size, std::make_pair(INT_MAX, NONE));
+        leaves = size;
+        for (int bandwidth = 0; bandwidth < leaves; bandwidth++) {
+            if (!heaps[bandwidth].empty()) {
+                tree[leaves + bandwidth] = std::make_pair(heaps[bandwidth].front().occupied_time,
+                                                          heaps[bandwidth].front().flow);
+            }
+        }
+        for (int node = leaves - 1; node > 0; node--) {
+            tree[node] = std::min(tree[2 * node], tree[2 * node + 1]);
+        }
+    }
+
+    // 带宽bandwidth的堆顶变化后更新线段树
+    void update(int bandwidth) {
+        const std::vector<Entry> &heap = heaps[bandwidth];
+        int node = leaves + bandwidth;
+        tree[node] = heap.empty() ? std::make_pair(INT_MAX, NONE)
+                                  : std::make_pair(heap.front().occupied_time, heap.front().flow);
+        for (node >>= 1; node > 0; node >>= 1) {
+            tree[node] = std::min(tree[2 * node], tree[2 * node + 1]);
+        }
+    }
+};
+
+// 调度区：按occupied_time升序排列的流，occupied_time相同的按进入调度区的先后
+// occupied_time是较小的整数，每个取值一个桶，桶内是以流下标串起的双向链表，链接存放在按下标索引的数组中
+// 插入与删除都是O(1)且不分配节点；非空桶记录在两级位图中，找下一个非空桶只需几次位运算
+// 桶的数量随出现过的最大occupied_time增长，内存与之成正比；另用BandwidthIndex按带宽索引
+class WaitPool {
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+public:
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    // 将流flow（FlowTable中的下标）加到其occupied_time桶的末尾
+    void push(uint32_t flow, int occupied_time, int bandwidth) {
+        link(flow, occupied_time);
+        journal.record(Change{Change::LINK, flow, 0, NONE, NONE});
+        fits.insert(flow, bandwidth, occupied_time);
+    }
+
+    void erase(uint32_t flow) {
+        journal.record(Change{Change::UNLINK, flow, key[flow], prev[flow], next[flow]});
+        unlink(flow);
+        fits.erase(flow);
+    }
+
+    // 将flow移到其桶的末尾，与从multiset中取出再放回的顺序一致
+    void move_to_back(uint32_t flow) {
+        int bucket = key[flow];
+        if (tail[bucket] == flow) {
+            return;
+        }
+        journal.record(Change{Change::UNLINK, flow, bucket, prev[flow], next[flow]});
+        unlink(flow);
+        link(flow, bucket);
+        journal.record(Change{Change::LINK, flow, 0, NONE, NONE});
+    }
+
+    // 带宽不超过capacity的流中occupied_time最短的一个，不存在时返回NONE
+    uint32_t fit(int capacity) const {
+        return fits.fit(capacity);
+    }
+
+    // 带宽不超过capacity的流中带宽最大的一个，不存在时返回NONE
+    uint32_t widest(int capacity) const {
+        return fits.widest(capacity);
+    }
+
+    // 第一个流，调度区为空时返回NONE
+    uint32_t front() const {
+        int bucket = next_bucket(0);
+        return bucket < 0 ? NONE : head[bucket];
+    }
+
+    // flow之后的一个流，flow是最后一个时返回NONE
+    uint32_t after(uint32_t flow) const {
+        if (next[flow] != NONE) {
+            return next[flow];
+        }
+        int bucket = next_bucket(key[flow] + 1);
+        return bucket < 0 ? NONE : head[bucket];
+    }
+
+    // 快照在调度区及其带宽索引的日志中的位置
+    class Mark {
+    public:
+        size_t links;
+        size_t fits;
+    };
+
+    Mark open_journal() {
+        return Mark{journal.open(), fits.open_journal()};
+    }
+
+    void close_journal() {
+        journal.close();
+        fits.close_journal();
+    }
+
+    // 按相反顺序撤销链表的修改：加入的流摘下，摘下的流放回原来的前后两个流之间
+    void rollback(const Mark &mark) {
+        journal.rollback(mark.links, [&](const Change &change) {
+            if (change.kind == Change::LINK) {
+                unlink(change.flow);
+            } else {
+                relink(change.flow, change.bucket, change.prev, change.next);
+            }
+        });
+        fits.rollback(mark.fits);
+    }
+
+private:
+    // 对链表的一个修改，摘下时记录流原来所在的桶与前后两个流
+    class Change {
+    public:
+        enum Kind {
+            LINK,
+            UNLINK,
+        };
+        Kind kind;
+        uint32_t flow;
+        int bucket;
+        uint32_t prev;
+        uint32_t next;
+    };
+
+    size_t count = 0;
+    // 桶内链表
+    std::vector<uint32_t> next;
+    std::vector<uint32_t> prev;
+    std::vector<int> key;
+    // 每个occupied_time桶的首尾
+    std::vector<uint32_t> head;
+    std::vector<uint32_t> tail;
+    // words的第i位表示第i个桶非空，summary的第j位表示words[j]非零
+    std::vector<uint64_t> words;
+    std::vector<uint64_t> summary;
+    BandwidthIndex fits;
+    Journal<Change> journal;
+
+    void link(uint32_t flow, int occupied_time) {
+        int bucket = std::max(0, occupied_time);
+        if (flow >= next.size()) {
+            next.resize(flow + 1, NONE);
+            prev.resize(flow + 1, NONE);
+            key.resize(flow + 1, 0);
+        }
+        if (bucket >= (int) head.size()) {
+            grow(bucket + 1);
+        }
+        key[flow] = bucket;
+        next[flow] = NONE;
+        prev[flow] = tail[bucket];
+        if (tail[bucket] == NONE) {
+            head[bucket] = flow;
+            mark(bucket);
+        } else {
+            next[tail[bucket]] = flow;
+        }
+        tail[bucket] = flow;
+        count++;
+    }
+
+    void unlink(uint32_t flow) {
+        int bucket = key[flow];
+        if (prev[flow] == NONE) {
+            head[bucket] = next[flow];
+        } else {
+            next[prev[flow]] = next[flow];
+        }
+        if (next[flow] == NONE) {
+            tail[bucket] = prev[flow];
+        } else {
+            prev[next[flow]] = prev[flow];
+        }
+        if (head[bucket] == NONE) {
+            unmark(bucket);
+        }
+        count--;
+    }
+
+    // 将flow放回桶bucket中before与after之间，两者为NONE时分别表示桶首与桶尾
+    void relink(uint32_t flow, int bucket, uint32_t before, uint32_t after) {
+        if (head[bucket] == NONE) {
+            mark(bucket);
+        }
+        key[flow] = bucket;
+        prev[flow] = before;
+        next[flow] = after;
+        if (before == NONE) {
+            head[bucket] = flow;
+        } else {
+            next[before] = flow;
+        }
+        if (after == NONE) {
+            tail[bucket] = flow;
+        } else {
+            prev[after] = flow;
+        }
+        count++;
+    }
+
+    void grow(int buckets) {
+        // 按64的倍数成倍扩大，避免频繁扩容
+        int size = std::max(buckets, (int) head.size() * 2);
+        size = (size + 63) / 64 * 64;
+        head.resize(size, NONE);
+        tail.resize(size, NONE);
+        words.resize(size / 64, 0);
+        summary.resize((words.size() + 63) / 64, 0);
+    }
+
+    void mark(int bucket) {
+        words[bucket >> 6] |= 1ull << (bucket & 63);
+        summary[bucket >> 12] |= 1ull << ((bucket >> 6) & 63);
+    }
+
+    void unmark(int bucket) {
+        words[bucket >> 6] &= ~(1ull << (bucket & 63));
+        if (words[bucket >> 6] == 0) {
+            summary[bucket >> 12] &= ~(1ull << ((bucket >> 6) & 63));
+        }
+    }
+
+    // 不小于bucket的第一个非空桶，不存在时返回-1
+    int next_bucket(int bucket) const {
+        int word = bucket >> 6;
+        if (word >= (int) words.size()) {
+            return -1;
+        }
+        uint64_t bits = words[word] & (~0ull << (bucket & 63));
+        if (bits != 0) {
+            return (word << 6) + __builtin_ctzll(bits);
+        }
+        // 在summary中找word之后的第一个非零word
+        word++;
+        int group = word >> 6;
+        if (group >= (int) summary.size()) {
+            return -1;
+        }
+        uint64_t groups = (word & 63) == 0 ? summary[group] : summary[group] & (~0ull << (word & 63));
+        while (groups == 0) {
+            if (++group >= (int) summary.size()) {
+                return -1;
+            }
+            groups = summary[group];
+        }
+        word = (group << 6) + __builtin_ctzll(groups);
+        return (word << 6) + __builtin_ctzll(words[word]);
+    }
+};
+
+// 计算time之后最早的一个有端口状态发生变化的时刻：某个流释放带宽，或某个端口排队区首流可能可以发出
+// 若不存在这样的时刻，返回INT_MAX
+inline int next_event_time(const PortPool &port_pool, int time) {
+    if (port_pool.any_active()) {
+        return time + 1;
+    }
+    return port_pool.any_occupied() ? port_pool.next_occupy().release_time : INT_MAX;
+}
+
+// 更新time时刻的带宽容量与排队区，只访问到时释放的流以及可能发出排队流的端口
+inline void update_ports(PortPool &port_pool, FlowTable &table, bool &bandwidth_changed, int time) {
+    SOLVE_TIMER(update_time);
+    SOLVE_COUNT(update_calls, 1);
+    // 需要检查排队区的端口：上一时间单位发出过排队流的端口，以及本时间单位有流释放的端口
+    std::vector<int> check_ports;
+    port_pool.begin_update(check_ports);
+    // 释放到时的流
+    while (port_pool.any_occupied() && port_pool.next_occupy().release_time <= time) {
+        const Occupy &occupy = port_pool.next_occupy();
+        port_pool.change_capacity(occupy.port, occupy.bandwidth);
+        check_ports.push_back(occupy.port);
+        port_pool.add_freed(occupy.port);
+        port_pool.pop_occupy();
+        bandwidth_changed = true;
+    }
+    std::sort(check_ports.begin(), check_ports.end());
+    check_ports.erase(std::unique(check_ports.begin(), check_ports.end()), check_ports.end());
+    for (auto index: check_ports) {
+        Port &port = port_pool.ports[index];
+        // 若port排队区非空，且排队首元素带宽小于此时端口带宽容量，发出
+        if (!port.wait_queue.empty()) {
+            uint32_t first_flow = port.wait_queue.front();
+            if (table.bandwidth[first_flow] <= port.bandwidth_capacity) {
+                port_pool.occupy(index, time, table.bandwidth[first_flow], table.occupied_time[first_flow]);
+                port_pool.pop_queue(index);
+                table.release(first_flow);
+                // 每个时间单位每个端口只发出一个排队流，剩余的下一时间单位再检查
+                if (!port.wait_queue.empty()) {
+                    port_pool.add_active(index);
+                }
+            }
+        }
+    }
+    port_pool.end_update();
+}
+
+// 调度区未满时按placement选择端口
+inline int place_flow(const PortPool &port_pool, Placement placement, int bandwidth, int time, int occupied_time) {
+    switch (placement) {
+        case Placement::WORST_FIT:
+            return port_pool.worst_fit(bandwidth);
+        case Placement::EARLIEST_FINISH:
+            return port_pool.earliest_finish(bandwidth, time, occupied_time);
+        default:
+            return port_pool.best_fit(bandwidth);
+    }
+}
+
+// pool_size为调度区中除本流以外的流数
+inline bool put_flow(uint32_t flow, int time, PortPool &port_pool, FlowTable &table, Placement placement,
+                     int pool_size, int max_pool_size, ResultSink &sink) {
+    // 调度区未满时，只能发往带宽容量足够的端口，按placement选择，默认选其中容量最小的一个
+    // 调度区已满时，按带宽容量升序第一个最大带宽足够的端口：若带宽容量也足够则直接发出，否则进入其排队区
+    SOLVE_COUNT(put_flow_probes, 1);
+    bool pool_full = pool_size >= max_pool_size;
+    int bandwidth = table.bandwidth[flow];
+    int index = pool_full ? port_pool.first_max_fit(bandwidth)
+                          : place_flow(port_pool, placement, bandwidth, time, table.occupied_time[flow]);
+    if (index == -1) {
+        // 没有找到能放得下本流的端口
+        return false;
+    }
+    Port &port = port_pool.ports[index];
+    // 写出安排结果：time时刻发往port
+    if (bandwidth <= port.bandwidth_capacity) {
+        // 占用port的带宽
+        sink.put(table.id[flow], port.id, time);
+        port_pool.occupy(index, time, bandwidth, table.occupied_time[flow]);
+        table.release(flow);
+    } else if (!port_pool.queue_full(index)) {
+        // 若本port的排队区未满，其排队区加入本流；否则，该流在该端口被抛弃
+        sink.put(table.id[flow], port.id, time);
+        port_pool.push_queue(index, flow);
+        port_pool.requeue(index);
+    } else {
+        SOLVE_COUNT(queue_drops, 1);
+        sink.discard(table.id[flow], port.id, time);
+        table.release(flow);
+        port_pool.requeue(index);
+    }
+    return true;
+}
+
+// 用调度区中的流填满刚释放了带宽的端口：每次取带宽不超过端口带宽容量的流中occupied_time最短的一个，直到放不下为止
+// 排队区非空的端口留给排队的流
+inline void fill_freed_ports(PortPool &port_pool, FlowTable &table, WaitPool &wait_queue, ResultSink &sink,
+                             int time) {
+    SOLVE_TIMER(fill_time);
+    for (int i = 0; i < port_pool.freed_count(); i++) {
+        int index = port_pool.freed_port(i);
+        Port &port = port_pool.ports[index];
+        if (!port.wait_queue.empty()) {
+            continue;
+        }
+        uint32_t flow;
+        while ((flow = wait_queue.fit(port.bandwidth_capacity)) != WaitPool::NONE) {
+            SOLVE_COUNT(fills, 1);
+            sink.put(table.id[flow], port.id, time);
+            port_pool.occupy(index, time, table.bandwidth[flow], table.occupied_time[flow]);
+            wait_queue.erase(flow);
+            table.release(flow);
+        }
+    }
+}
+
+// 看等待队列中的首SEE_NUM个流是否可以发出
+// 若首个流发出了，继续看等待队列中的首SEE_NUM个流是否可以发出
+inline void check_flows(PortPool &port_pool, FlowTable &table, WaitPool &wait_queue, Placement placement,
+                        int max_pool_size, ResultSink &sink, int time, int see_num) {
+    SOLVE_TIMER(check_time);
+    // 发出流是否成功的标志
+    bool put_success;
+    int see_counter = see_num;
+    uint32_t wait_flow = wait_queue.front();
+    while (wait_flow != WaitPool::NONE && see_counter) {
+        // 尝试期间流不离开调度区，只是不计入调度区大小
+        put_success = put_flow(wait_flow, time, port_pool, table, placement, (int) wait_queue.size() - 1,
+                               max_pool_size, sink);
+        uint32_t next_flow;
+        if (put_success) {
+            SOLVE_COUNT(check_successes, 1);
+            next_flow = wait_queue.after(wait_flow);
+            wait_queue.erase(wait_flow);
+            see_counter = see_num;
+        } else {
+            // 发不出的流移到同occupied_time的流的末尾，接着看occupied_time更大的流
+            SOLVE_COUNT(check_failures, 1);
+            wait_queue.move_to_back(wait_flow);
+            next_flow = wait_queue.after(wait_flow);
+            see_counter--;
+        }
+        wait_flow = next_flow;
+    }
+}
+
+// flows排序：到达时间升序，同时到达的按config.flow_order
+inline void sort_flows(std::vector<Flow> &flows, FlowOrder flow_order) {
+    switch (flow_order) {
+        case FlowOrder::OCCUPIED_THEN_BANDWIDTH:
+            // coming_time升序->occupied_time升序->bandwidth降序
+            std::sort(flows.begin(), flows.end(), [](const Flow &a, const Flow &b) {
+                if (a.coming_time == b.coming_time) {
+                    if (a.occupied_time == b.occupied_time) {
+                        return a.bandwidth > b.bandwidth;
+                    } else {
+                        return a.occupied_time < b.occupied_time;
+                    }
+                } else {
+                    return a.coming_time < b.coming_time;
+                }
+            });
+            break;
+        case FlowOrder::BANDWIDTH_THEN_OCCUPIED:
+            // coming_time升序->bandwidth降序->occupied_time升序
+            std::sort(flows.begin(), flows.end(), [](const Flow &a, const Flow &b) {
+                if (a.coming_time == b.coming_time) {
+                    if (a.bandwidth == b.bandwidth) {
+                        return a.occupied_time < b.occupied_time;
+                    } else {
+                        return a.bandwidth > b.bandwidth;
+                    }
+                } else {
+                    return a.coming_time < b.coming_time;
+                }
+            });
+            break;
+        case FlowOrder::INPUT:
+            std::stable_sort(flows.begin(), flows.end(), [](const Flow &a, const Flow &b) {
+                return a.coming_time < b.coming_time;
+            });
+            break;
+    }
+}
+
+// 流的来源，按调度顺序逐个给出流
+class FlowSource {
+public:
+    virtual ~FlowSource() = default;
+
+    // 下一个流，没有更多的流时返回nullptr；返回的指针在下一次调用前有效
+    virtual const Flow *next() = 0;
+};
+
+// 内存中已由sort_flows排好序的流
+class VectorFlowSource : public FlowSource {
+public:
+    explicit VectorFlowSource(const std::vector<Flow> &flows) : flows(flows) {}
+
+    const Flow *next() override {
+        return index < flows.size() ? &flows[index++] : nullptr;
+    }
+
+private:
+    const std::vector<Flow> &flows;
+    size_t index = 0;
+};
+
+// 到达时间相同的两个流按flow_order比较，与sort_flows的顺序一致
+inline bool flow_before(const Flow &a, const Flow &b, FlowOrder flow_order) {
+    if (a.coming_time != b.coming_time) {
+        return a.coming_time < b.coming_time;
+    }
+    switch (flow_order) {
+        case FlowOrder::OCCUPIED_THEN_BANDWIDTH:
+            if (a.occupied_time != b.occupied_time) {
+                return a.occupied_time < b.occupied_time;
+            }
+            return a.bandwidth > b.bandwidth;
+        case FlowOrder::BANDWIDTH_THEN_OCCUPIED:
+            if (a.bandwidth != b.bandwidth) {
+                return a.bandwidth > b.bandwidth;
+            }
+            return a.occupied_time < b.occupied_time;
+        default:
+            return false;
+    }
+}
+
+// 流式读取flow.txt，内存中只保留重排窗口内的流
+// 文件需按到达时间排序，或只在window行的范围内乱序：读入的流先进入容量为window的小根堆，堆满时才给出堆顶
+// 超出窗口的乱序流到达时间已早于调度器的当前时刻，按当前时刻到达处理，发送时间仍不早于其真实到达时间
+class FlowStream : public FlowSource {
+public:
+    // 已读入的流数量
+    long long flows = 0;
+    // 超出重排窗口、被推迟到当前时刻到达的流数量
+    long long late_flows = 0;
+
+public:
+    // 先扫描一遍文件求平均带宽，再从头流式读取
+    bool open(const std::string &path, size_t window, FlowOrder flow_order) {
+        this->path = path;
+        this->window = std::max<size_t>(1, window);
+        this->flow_order = flow_order;
+        if (!file.open(path, true)) {
+            return false;
+        }
+        long long total_bandwidth = 0;
+        long long count = 0;
+        int row[4];
+        while (file.next(row)) {
+            total_bandwidth += row[1];
+            count++;
+        }
+        average = (double) total_bandwidth / (double) count;
+        return file.open(path, true);
+    }
+
+    double average_bandwidth() const {
+        return average;
+    }
+
+    const Flow *next() override {
+        int row[4];
+        while (pending.size() < window && file.next(row)) {
+            pending.emplace_back(Flow(row[0], row[1], row[2], row[3]), flows++);
+            std::push_heap(pending.begin(), pending.end(), later_cmp{flow_order});
+        }
+        if (file.failed() && !reported) {
+            std::cerr << path << ": bad line " << file.bad_line() << std::endl;
+            reported = true;
+        }
+        if (pending.empty()) {
+            return nullptr;
+        }
+        std::pop_heap(pending.begin(), pending.end(), later_cmp{flow_order});
+        current = pending.back().first;
+        pending.pop_back();
+        if (current.coming_time < last_time) {
+            current.coming_time = last_time;
+            late_flows++;
+        }
+        last_time = current.coming_time;
+        return &current;
+    }
+
+private:
+    // 堆顶是最早应给出的流，顺序相同时先读入的在前
+    class later_cmp {
+    public:
+        FlowOrder flow_order;
+
+        bool operator()(const std::pair<Flow, long long> &a, const std::pair<Flow, long long> &b) const {
+            if (flow_before(a.first, b.first, flow_order)) {
+                return false;
+            }
+            if (flow_before(b.first, a.first, flow_order)) {
+                return true;
+            }
+            return a.second > b.second;
+        }
+    };
+
+    std::string path;
+    CsvFile file;
+    size_t window = 1;
+    FlowOrder flow_order = FlowOrder::OCCUPIED_THEN_BANDWIDTH;
+    double average = 0;
+    std::vector<std::pair<Flow, long long>> pending;
+    Flow current = Flow(-1, 0, 0, 0);
+    int last_time = INT_MIN;
+    bool reported = false;
+};
+
+// 调度的全部可变状态：按调度顺序逐个接收到达的流，流读完后发出剩余的流
+// 可以在任意两次调用之间打快照，尝试若干种后续分支后回滚到快照处，不必从头重新模拟；
+// 各部分只记录快照后的修改，打快照与回滚的开销与其间的修改量成正比。快照之后写入sink的决策由调用者丢弃
+class ScheduleState {
+public:
+    // 端口池，按带宽容量索引
+    PortPool port_pool;
+    // 尚未发出的流
+    FlowTable table;
+    // 调度区的流，按occupied_time升序
+    // 该队列的大小即为当前调度区中流的数量
+    WaitPool wait_queue;
+    // 计时器
+    int time = 0;
+    // 带宽是否发生变化的标志，作为剪枝，避免无意义地尝试发出流
+    bool bandwidth_changed = false;
+
+public:
+    // 快照：各部分日志中的位置与打快照时的计时器
+    class Snapshot {
+    public:
+        size_t ports;
+        size_t table;
+        WaitPool::Mark pool;
+        int time;
+        bool bandwidth_changed;
+    };
+
+public:
+    // average_bandwidth为全部流的平均带宽
+    ScheduleState(const std::vector<Port> &ports, double average_bandwidth, const SolveConfig &config)
+            : port_pool(ports, config.port_queue_cap), config(config) {
+        this->average_bandwidth = average_bandwidth;
+        // 调度区最大容量，每次求解各自计算，多个数据集可以并发求解
+        this->max_pool_size = port_pool.size() * config.pool_factor;
+    }
+
+    // 流按调度顺序到达
+    void arrive(const Flow &flow, ResultSink &sink) {
+        advance_ports(flow.coming_time, sink);
+        admit(flow, sink);
+        check(sink);
+    }
+
+    // 同一时刻到达的count个流：config.batch_admission时全部进入调度区后一起装箱，否则逐个到达
+    void arrive_batch(const Flow *flows, size_t count, ResultSink &sink) {
+        if (!config.batch_admission) {
+            for (size_t i = 0; i < count; i++) {
+                arrive(flows[i], sink);
+            }
+            return;
+        }
+        if (count == 0) {
+            return;
+        }
+        advance_ports(flows[0].coming_time, sink);
+        for (size_t i = 0; i < count; i++) {
+            admit(flows[i], sink);
+        }
+        pack(sink);
+        check(sink);
+    }
+
+    // 装箱：反复取调度区中能放进带宽容量最大的端口的最宽的流，放入带宽容量最小的能放下它的端口，直到放不下为止
+    // 与fill_freed_ports一样只用排队区为空的端口，排队区非空的端口留给排队的流
+    // 每放一个流只需在带宽索引与端口容量索引上各查询一次，不必排序
+    void pack(ResultSink &sink) {
+        SOLVE_TIMER(check_time);
+        while (!wait_queue.empty() && port_pool.size() > 0) {
+            uint32_t flow = wait_queue.widest(port_pool.idle_max_capacity());
+            if (flow == WaitPool::NONE) {
+                break;
+            }
+            int index = port_pool.idle_best_fit(table.bandwidth[flow]);
+            SOLVE_COUNT(check_successes, 1);
+            sink.put(table.id[flow], port_pool.ports[index].id, time);
+            port_pool.occupy(index, time, table.bandwidth[flow], table.occupied_time[flow]);
+            wait_queue.erase(flow);
+            table.release(flow);
+        }
+    }
+
+
+    // 读取flow结束，等待时间中的各流可视为同时到达，此时wait_queue只有出没有入，不可能爆调度区
+    void finish(ResultSink &sink) {
+        advance(INT_MAX, sink);
+    }
+
+    // 暂时没有流到达，把调度区中的流的处理推进到now：在其间每个端口状态发生变化的时刻更新端口，带宽变化了就再看调度区
+    // 调度区空了即停止，剩下的端口更新留到下一个流到达时再做
+    void advance(int now, ResultSink &sink) {
+        while (!wait_queue.empty()) {
+            // 更新时间至下一个端口状态发生变化的时刻
+            int next_time = next_event_time(port_pool, time);
+            // 端口状态不会再变化，剩余的流无论如何都发不出去
+            if (next_time == INT_MAX || next_time > now) {
+                break;
+            }
+            time = next_time;
+            SOLVE_PEAK(ticks, time);
+            bandwidth_changed = false;
+            update_ports(port_pool, table, bandwidth_changed, time);
+            if (config.fill_freed_ports) {
+                fill_freed_ports(port_pool, table, wait_queue, sink, time);
+            }
+            if (config.batch_admission) {
+                pack(sink);
+            }
+            if (bandwidth_changed) {
+                check_flows(port_pool, table, wait_queue, config.placement, max_pool_size, sink, time,
+                            config.see_num_changed);
+            }
+        }
+    }
+
+    // 加入一个端口，调度区容量随之增大；不能在有打开的快照时调用
+    void add_port(const Port &port) {
+        port_pool.add_port(port);
+        max_pool_size = port_pool.size() * config.pool_factor;
+    }
+
+    // 流事先未知时，用已到达的流的平均带宽代替全部流的平均带宽
+    void set_average_bandwidth(double average_bandwidth) {
+        this->average_bandwidth = average_bandwidth;
+    }
+
+    // 打快照，此后各部分开始记录修改
+    Snapshot mark() {
+        return Snapshot{port_pool.open_journal(), table.open_journal(), wait_queue.open_journal(), time,
+                        bandwidth_changed};
+    }
+
+    // 回到快照snapshot时的状态，快照仍然有效，可以继续尝试别的分支；snapshot须是最内层的快照
+    void rollback(const Snapshot &snapshot) {
+        port_pool.rollback(snapshot.ports);
+        table.rollback(snapshot.table);
+        wait_queue.rollback(snapshot.pool);
+        time = snapshot.time;
+        bandwidth_changed = snapshot.bandwidth_changed;
+    }
+
+    // 放弃最内层的快照，保留当前状态
+    void release() {
+        port_pool.close_journal();
+        table.close_journal();
+        wait_queue.close_journal();
+    }
+
+private:
+    SolveConfig config;
+    double average_bandwidth;
+    int max_pool_size;
+
+    // 看调度区中的流能否发出
+    void check(ResultSink &sink) {
+        if (bandwidth_changed) {
+            check_flows(port_pool, table, wait_queue, config.placement, max_pool_size, sink, time,
+                        config.see_num_changed);
+        } else {
+            check_flows(port_pool, table, wait_queue, config.placement, max_pool_size, sink, time,
+                        config.see_num_unchanged);
+        }
+    }
+
+    // 有流在to时刻到达，先更新端口：只在端口状态发生变化的时刻更新，跳过其间无事发生的时间
+    void advance_ports(int to, ResultSink &sink) {
+        // 当前流的到达时间大于程序中存储的时间，更新时间
+        if (to > time) {
+            int next_time;
+            while ((next_time = next_event_time(port_pool, time)) <= to) {
+                update_ports(port_pool, table, bandwidth_changed, next_time);
+                if (config.fill_freed_ports) {
+                    fill_freed_ports(port_pool, table, wait_queue, sink, next_time);
+                }
+                time = next_time;
+            }
+            // 状态更新完毕，更新时间
+            time = to;
+            SOLVE_PEAK(ticks, time);
+        }
+    }
+
+    // 流进入调度区；调度区满时可能抛弃调度区的首流
+    void admit(const Flow &flow, ResultSink &sink) {
+        SOLVE_TIMER(admit_time);
+        SOLVE_COUNT(arrivals, 1);
+        // 端口更新完毕后本流才进入调度区，不会在到达之前被发出
+        wait_queue.push(table.add(flow), flow.occupied_time, flow.bandwidth);
+        SOLVE_PEAK(peak_pool_size, wait_queue.size());
+        // 若调度区已满，且有排队区满以及最大带宽大于流宽的端口，把等待队列中首流拿出来在此端口抛弃
+        // 排队区满的端口由port_pool增量维护，按带宽容量升序选第一个
+        if ((int) wait_queue.size() >= max_pool_size && port_pool.any_queue_full() &&
+            table.bandwidth[wait_queue.front()] > average_bandwidth * config.discard_ratio) {
+            uint32_t wait_flow = wait_queue.front();
+            int index = port_pool.full_queue_fit(table.bandwidth[wait_flow]);
+            if (index != -1) {
+                SOLVE_COUNT(discards, 1);
+                sink.discard(table.id[wait_flow], port_pool.ports[index].id, time);
+                wait_queue.erase(wait_flow);
+                table.release(wait_flow);
+            } else {
+                // 到此，若找不到能抛弃的端口，将其放回队列
+                wait_queue.move_to_back(wait_flow);
+            }
+        }
+    }
+};
+
+// 按source给出的顺序调度，average_bandwidth为全部流的平均带宽
+inline void schedule(FlowSource &source, double average_bandwidth, std::vector<Port> &ports, ResultSink &sink,
+                     const SolveConfig &config = SolveConfig()) {
+    ScheduleState state(ports, average_bandwidth, config);
+    const Flow *next_flow;
+    if (config.batch_admission) {
+        // 攒齐同一时刻到达的流再一起调度
+        std::vector<Flow> batch;
+        while ((next_flow = source.next()) != nullptr) {
+            if (!batch.empty() && next_flow->coming_time != batch.back().coming_time) {
+                state.arrive_batch(batch.data(), batch.size(), sink);
+                batch.clear();
+            }
+            batch.push_back(*next_flow);
+        }
+        state.arrive_batch(batch.data(), batch.size(), sink);
+    } else {
+        while ((next_flow = source.next()) != nullptr) {
+            state.arrive(*next_flow, sink);
+        }
+    }
+    state.finish(sink);
+    sink.flush();
+}
+
+// 调度已由sort_flows排好序的flows
+inline void schedule(std::vector<Flow> &flows, std::vector<Port> &ports, ResultSink &sink,
+                     const SolveConfig &config = SolveConfig()) {
+    // 计算所有流的平均带宽，千万级的流带宽总和会超出int
+    long long total_bandwidth = 0;
+    for (auto &flow: flows) {
+        total_bandwidth += flow.bandwidth;
+    }
+    VectorFlowSource source(flows);
+    schedule(source, (double) total_bandwidth / (double) flows.size(), ports, sink, config);
+}
+
+inline void solve(std::vector<Flow> &flows, std::vector<Port> &ports, ResultSink &sink,
+                  const SolveConfig &config = SolveConfig()) {
+    sort_flows(flows, config.flow_order);
+    schedule(flows, ports, sink, config);
+}
+
+// 流式求解data_path下的数据集：边读flow.txt边调度，决策写入sink后即释放，内存与调度区及在途的流数成正比
+// stream返回时记录读入的流数与超出重排窗口的乱序流数
+inline void solve_stream(const std::string &data_path, size_t window, ResultSink &sink, FlowStream &stream,
+                         const SolveConfig &config = SolveConfig()) {
+    std::vector<Port> ports;
+    read_ports(data_path, ports);
+    if (!stream.open(data_path + "/flow.txt", window, config.flow_order)) {
+        sink.flush();
+        return;
+    }
+    schedule(stream, stream.average_bandwidth(), ports, sink, config);
+}
+
+// 转换为评分库的输入
+inline std::vector<FlowInfo> flow_infos(const std::vector<Flow> &flows) {
+    std::vector<FlowInfo> infos;
+    infos.reserve(flows.size());
+    for (auto &flow: flows) {
+        infos.emplace_back(flow.id, flow.bandwidth, flow.coming_time, flow.occupied_time);
+    }
+    return infos;
+}
+
+inline std::vector<PortInfo> port_infos(const std::vector<Port> &ports) {
+    std::vector<PortInfo> infos;
+    infos.reserve(ports.size());
+    for (auto &port: ports) {
+        infos.emplace_back(port.id, port.max_bandwidth);
+    }
+    return infos;
+}
+
+#endif //ZTE_SOLVE_SOLVER_H